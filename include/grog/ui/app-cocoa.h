@@ -44,14 +44,34 @@ public:
     delegate_->AddWorkUnit(wu);
   }
 
-  inline virtual void RegisterMouseMotionEventHandler(
+  inline virtual void ScheduleWorkUnit(
+      const WorkUnit& wu, const Duration& delay) {
+    delegate_->ScheduleWorkUnit(wu, delay);
+  }
+
+  inline virtual void ScheduleRepeating(
+      const WorkUnit& wu, const Duration& interval) {
+    delegate_->ScheduleRepeating(wu, interval);
+  }
+
+  inline virtual util::HandlerToken RegisterMouseMotionEventHandler(
       const MouseMotionEventHandler& handler) {
-    delegate_->RegisterMouseMotionEventHandler(handler);
+    return delegate_->RegisterMouseMotionEventHandler(handler);
   }
 
-  inline virtual void RegisterMouseButtonEventHandler(
+  inline virtual util::HandlerToken RegisterMouseButtonEventHandler(
       const MouseButtonEventHandler& handler) {
-    delegate_->RegisterMouseButtonEventHandler(handler);
+    return delegate_->RegisterMouseButtonEventHandler(handler);
+  }
+
+  inline virtual void UnregisterMouseMotionEventHandler(
+      const util::HandlerToken& token) {
+    delegate_->UnregisterMouseMotionEventHandler(token);
+  }
+
+  inline virtual void UnregisterMouseButtonEventHandler(
+      const util::HandlerToken& token) {
+    delegate_->UnregisterMouseButtonEventHandler(token);
   }
 
   virtual void Run();
@@ -0,0 +1,73 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UI_APP_HEADLESS_H
+#define GROG_UI_APP_HEADLESS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "grog/ui/app.h"
+#include "grog/util/concurrent.h"
+
+namespace grog { namespace ui {
+
+/**
+ * An application loop that doesn't depend on any window system. It produces
+ * no input events, it just executes work units and scheduled work units
+ * until requested to stop.
+ */
+class HeadlessApplicationLoop : public AbstractApplicationLoop {
+public:
+
+  HeadlessApplicationLoop();
+
+  virtual void AddWorkUnit(const WorkUnit& wu);
+
+  virtual void Run();
+
+  virtual void Stop();
+
+private:
+
+  std::atomic<bool> running_;
+  util::MPSCQueue<WorkUnit> work_units_;
+  std::vector<WorkUnit> repeating_;
+  std::mutex wakeup_mutex_;
+  std::condition_variable wakeup_;
+
+  void WaitForWork();
+
+  void ProcessWorkUnits();
+};
+
+class SoftwareApplicationContextFactory : public ApplicationContextFactory {
+public:
+
+  virtual Ptr<Screen> CreateScreen(
+      const Application::Properties& props);
+
+  virtual Ptr<ApplicationLoop> CreateLoop(
+      const Application::Properties& props);
+};
+
+}} // namespace grog::ui
+
+#endif // GROG_UI_APP_HEADLESS_H
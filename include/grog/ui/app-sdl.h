@@ -19,13 +19,16 @@
 #ifndef GROG_UI_APP_SDL_H
 #define GROG_UI_APP_SDL_H
 
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
 
 #include "grog/ui/app.h"
+#include "grog/util/concurrent.h"
 
 extern "C" {
   union SDL_Event;
-  struct SDL_MouseMotionEvent;
   struct SDL_UserEvent;
 }
 
@@ -34,9 +37,50 @@ namespace grog { namespace ui {
 class SDLApplicationLoop : public AbstractApplicationLoop {
 public:
 
-  static Ptr<ApplicationLoop> instance();
-
-  ~SDLApplicationLoop();
+  /**
+   * The codes of the SDL user events pushed by the loop.
+   */
+  enum UserEventCode {
+    kRequestRedisplayEvent,
+    kWorkUnitPending,
+  };
+
+  /**
+   * Statistics of the input coalescing stage, which folds bursts of raw
+   * events into fewer events before dispatching them.
+   */
+  struct InputStats {
+    unsigned long raw_events;
+    unsigned long dispatched_events;
+    unsigned long folded_motion_events;
+    unsigned long folded_wheel_events;
+    unsigned long folded_wakeup_events;
+
+    inline InputStats()
+      : raw_events(0), dispatched_events(0), folded_motion_events(0),
+        folded_wheel_events(0), folded_wakeup_events(0) {}
+  };
+
+  /**
+   * A sequence of input events, along with the number of clicks each one
+   * stands for. Clicks are only meaningful for mouse button events.
+   */
+  struct InputBatch {
+    std::vector<SDL_Event> events;
+    std::vector<unsigned int> clicks;
+  };
+
+  static Ptr<SDLApplicationLoop> instance();
+
+  /**
+   * Fold the events of given batch in place, accounting the folded ones in
+   * given stats. Consecutive mouse motion events are folded into one with
+   * the accumulated relative motion, consecutive ticks of the same wheel
+   * are folded into one press and one release with the tick count as
+   * clicks, and all but the first work pending wake-up are dropped. The
+   * order of the remaining events is preserved.
+   */
+  static void CoalesceInput(InputBatch& batch, InputStats& stats);
 
   virtual void AddWorkUnit(const WorkUnit& wu);
 
@@ -44,20 +88,50 @@ public:
 
   virtual void Stop();
 
+  /**
+   * Set the maximum time spent running work units on each loop iteration.
+   * Once exceeded, the remaining work units are deferred until pending
+   * input events are processed. Zero means no limit.
+   */
+  inline void set_work_budget(const std::chrono::microseconds& budget) {
+    work_budget_ = budget;
+  }
+
+  /**
+   * Run the work units that are ready, as done on each loop iteration. It
+   * stops once the work budget is exceeded, leaving the remaining units
+   * for the next call. Repeating units are queued again behind them.
+   */
+  void ProcessWorkUnits();
+
+  inline const InputStats& input_stats() const { return input_stats_; }
+
+  inline void ResetInputStats() { input_stats_ = InputStats(); }
+
 private:
 
   bool running_;
-  std::queue<WorkUnit> work_units_;
-  SDL_Event* consolidation_pool_;
-  unsigned int consolidation_pool_len_;
+  util::MPSCQueue<WorkUnit> work_units_;
+  std::atomic<bool> wakeup_pending_;
+  std::deque<WorkUnit> ready_work_units_;
+  std::chrono::microseconds work_budget_;
+  InputBatch input_;
+  InputStats input_stats_;
 
   SDLApplicationLoop();
 
-  void ConsolidateMouseMotion(SDL_MouseMotionEvent& ev);
+  bool WaitEvent(SDL_Event& event);
 
-  void OnUserEvent(SDL_UserEvent& ev);
+  /**
+   * Process the given event along with all the pending ones, which were
+   * received at given time.
+   */
+  void ProcessInput(const SDL_Event& first, const EventTime& time);
 
-  void ProcessWorkUnit();
+  void DispatchEvent(
+      SDL_Event& event, unsigned int clicks, const EventTime& time);
+
+  void OnUserEvent(SDL_UserEvent& ev);
 };
 
 class SDLApplicationContextFactory : public ApplicationContextFactory {
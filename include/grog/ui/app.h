@@ -19,18 +19,22 @@
 #ifndef GROG_UI_APP_H
 #define GROG_UI_APP_H
 
+#include <chrono>
 #include <functional>
-#include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
 
+#include "grog/ui/damage.h"
 #include "grog/ui/draw.h"
 #include "grog/ui/event.h"
 #include "grog/util/error.h"
 #include "grog/util/lang.h"
+#include "grog/util/stats.h"
+#include "grog/util/timer.h"
 
 /**
  * The type of command line arguments for a Grog application.
@@ -64,16 +68,37 @@ public:
    */
   typedef std::function<bool(void)> WorkUnit;
 
+  /**
+   * The type of the delays and intervals of scheduled work units.
+   */
+  typedef std::chrono::milliseconds Duration;
+
   /**
    * Create a new application loop with an empty work unit list.
    */
   inline virtual ~ApplicationLoop() {}
   /**
-   * Add a new work unit for the loop to execute.
+   * Add a new work unit for the loop to execute. This may be invoked from
+   * any thread, but the work unit is always executed by the loop thread.
    * @param wu the working unit to execute
    */
   virtual void AddWorkUnit(const WorkUnit& wu) = 0;
 
+  /**
+   * Schedule a work unit to be executed once, after given delay. Its return
+   * value is ignored. This must be invoked from the loop thread.
+   */
+  virtual void ScheduleWorkUnit(const WorkUnit& wu, const Duration& delay) = 0;
+
+  /**
+   * Schedule a work unit to be executed periodically, every given interval,
+   * until it returns false. Executions missed because the loop was busy are
+   * skipped rather than run in a burst. This must be invoked from the loop
+   * thread.
+   */
+  virtual void ScheduleRepeating(
+      const WorkUnit& wu, const Duration& interval) = 0;
+
   /**
    * Run until the loop is requested to stop via stop() method.
    */
@@ -88,36 +113,103 @@ public:
 class AbstractApplicationLoop : public ApplicationLoop {
 public:
 
-  inline virtual void RegisterMouseMotionEventHandler(
+  AbstractApplicationLoop();
+
+  virtual void ScheduleWorkUnit(const WorkUnit& wu, const Duration& delay);
+
+  virtual void ScheduleRepeating(const WorkUnit& wu, const Duration& interval);
+
+  inline virtual util::HandlerToken RegisterMouseMotionEventHandler(
       const MouseMotionEventHandler& handler) {
-    mouse_motion_handlers_.push_back(handler);
+    return mouse_motion_handlers_.Add(handler);
   }
 
-  inline virtual void RegisterMouseButtonEventHandler(
+  inline virtual util::HandlerToken RegisterMouseButtonEventHandler(
       const MouseButtonEventHandler& handler) {
-    mouse_button_handlers_.push_back(handler);
+    return mouse_button_handlers_.Add(handler);
+  }
+
+  inline virtual void UnregisterMouseMotionEventHandler(
+      const util::HandlerToken& token) {
+    mouse_motion_handlers_.Remove(token);
+  }
+
+  inline virtual void UnregisterMouseButtonEventHandler(
+      const util::HandlerToken& token) {
+    mouse_button_handlers_.Remove(token);
   }
 
 protected:
 
   void HandleMouseMotionEvent(const MouseMotionEvent& event) {
-    for (auto& handler : mouse_motion_handlers_)
-      handler(event);
+    mouse_motion_handlers_.Dispatch(event);
   }
 
   void HandleMouseButtonEvent(const MouseButtonEvent& event) {
-    for (auto& handler : mouse_button_handlers_)
-      handler(event);
+    mouse_button_handlers_.Dispatch(event);
   }
 
+  /**
+   * Obtain the time point the next scheduled work unit is due, or none if
+   * there are no scheduled work units.
+   */
+  Option<std::chrono::steady_clock::time_point> NextTimerDeadline() const;
+
+  /**
+   * Execute the scheduled work units that are due.
+   */
+  void RunExpiredTimers();
+
 private:
 
-  std::list<MouseMotionEventHandler> mouse_motion_handlers_;
-  std::list<MouseButtonEventHandler> mouse_button_handlers_;
+  struct Timer {
+    WorkUnit wu;
+    Duration interval;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  typedef util::TimerWheel<Timer> TimerWheel;
+
+  util::HandlerTable<MouseMotionEventHandler> mouse_motion_handlers_;
+  util::HandlerTable<MouseButtonEventHandler> mouse_button_handlers_;
+  std::chrono::steady_clock::time_point epoch_;
+  TimerWheel timers_;
+  std::vector<Timer> expired_timers_;
+
+  TimerWheel::Ticks ToTicks(
+      const std::chrono::steady_clock::time_point& time) const;
+
+  void Schedule(const Timer& timer);
 };
 
 class Window;
 
+/**
+ * Statistics of the frames drawn by an application context.
+ */
+struct FrameStats {
+
+  typedef util::LatencyHistogram::Duration Duration;
+
+  /**
+   * The frames drawn so far.
+   */
+  unsigned long frames;
+
+  /**
+   * The frame slots missed because a frame took longer than the frame
+   * interval to be drawn.
+   */
+  unsigned long skipped;
+
+  /**
+   * The time it took to draw each frame, including presenting it.
+   */
+  util::LatencyHistogram frame_time;
+
+  inline FrameStats() : frames(0), skipped(0) {}
+};
+
 class ApplicationContext {
 public:
 
@@ -131,7 +223,40 @@ public:
 
   virtual void set_window(const Ptr<Window>& window) = 0;
 
+  /**
+   * Request the whole window to be redrawn.
+   */
   virtual void PostRedisplay() = 0;
+
+  /**
+   * Request the given region of the screen to be redrawn. Regions posted
+   * before the next frame is drawn are accumulated, and only the widgets
+   * that intersect them are drawn again.
+   */
+  virtual void PostRedisplay(const Rect2<int>& region) = 0;
+
+  /**
+   * Deliver the notifications posted to given channel from the loop, once
+   * per frame and right before drawing it. Notifications posted many times
+   * within a frame are delivered once, so the work they trigger per frame
+   * is bounded no matter how often they are posted. Posting must be done
+   * from the loop thread.
+   */
+  virtual void DeferNotifications(
+      const Ptr<util::NotificationChannel>& channel) = 0;
+
+  /**
+   * Obtain the input-to-photon latencies measured so far. The latency of
+   * an input event is measured when a redisplay posted while the event was
+   * being dispatched is presented on screen.
+   */
+  virtual const util::LatencyHistogram& input_latency() const = 0;
+
+  virtual void ResetInputLatency() = 0;
+
+  virtual const FrameStats& frame_stats() const = 0;
+
+  virtual void ResetFrameStats() = 0;
 };
 
 class DefaultApplicationContext : public ApplicationContext {
@@ -140,6 +265,8 @@ public:
   DefaultApplicationContext(const Ptr<ApplicationLoop>& loop,
                             const Ptr<Screen>& screen);
 
+  virtual ~DefaultApplicationContext();
+
   inline ApplicationLoop& loop() { return *loop_; }
 
   inline Screen& screen() { return *screen_; }
@@ -153,12 +280,71 @@ public:
 
   virtual void PostRedisplay();
 
+  virtual void PostRedisplay(const Rect2<int>& region);
+
+  virtual void DeferNotifications(
+      const Ptr<util::NotificationChannel>& channel);
+
+  inline virtual const util::LatencyHistogram& input_latency() const {
+    return input_latency_;
+  }
+
+  inline virtual void ResetInputLatency() { input_latency_.Clear(); }
+
+  inline virtual const FrameStats& frame_stats() const {
+    return frame_stats_;
+  }
+
+  inline virtual void ResetFrameStats() { frame_stats_ = FrameStats(); }
+
+  /**
+   * Set the minimum interval between the start of two frames. Frames are
+   * aligned to slots of this interval, so redisplays requested many times
+   * within a slot are drawn once; slots missed while drawing a frame that
+   * overran are skipped. A zero interval draws frames as soon as they are
+   * requested, which is the default.
+   */
+  inline void set_frame_interval(const FrameStats::Duration& interval) {
+    frame_interval_ = interval;
+  }
+
+  inline FrameStats::Duration frame_interval() const {
+    return frame_interval_;
+  }
+
 private:
 
+  typedef std::weak_ptr<util::NotificationChannel> ChannelRef;
+
   Ptr<ApplicationLoop> loop_;
   Ptr<Screen> screen_;
   Ptr<Window> window_;
-  bool post_redisplay_requested_;
+  bool frame_requested_;
+  std::vector<ChannelRef> deferred_channels_;
+  DamageRegion damage_;
+  DamageRegion last_damage_;
+  util::HandlerToken mouse_motion_token_;
+  util::HandlerToken mouse_button_token_;
+  EventTime dispatched_input_time_;
+  EventTime damage_input_time_;
+  util::LatencyHistogram input_latency_;
+  FrameStats frame_stats_;
+  FrameStats::Duration frame_interval_;
+  std::chrono::steady_clock::time_point next_frame_time_;
+
+  void RequestFrame();
+
+  void DrawFrame();
+
+  void ScheduleNextFrame(const std::chrono::steady_clock::time_point& start,
+                         const std::chrono::steady_clock::time_point& end);
+
+  void FlushNotifications();
+
+  void Redisplay();
+
+  template <typename Event>
+  void DispatchInput(const Event& ev);
 
   inline DefaultApplicationContext(const DefaultApplicationContext&) {}
 
@@ -195,6 +381,14 @@ public:
    */
   inline void PostRedisplay() { context()->PostRedisplay(); }
 
+  /**
+   * Convenience function to post redisplay of a screen region using the
+   * application context.
+   */
+  inline void PostRedisplay(const Rect2<int>& region) {
+    context()->PostRedisplay(region);
+  }
+
 private:
 
   Ptr<ApplicationContext> context_;
@@ -248,11 +442,49 @@ public:
    */
   static const PropertyName kPropNameAppEngine;
 
+  /**
+   * The property name for the time in milliseconds the application loop
+   * may spend running work units before processing input again (0 for no
+   * limit)
+   */
+  static const PropertyName kPropNameLoopWorkBudget;
+
+  /**
+   * The property name for whether to print a report of the input-to-photon
+   * latency when the application loop finishes
+   */
+  static const PropertyName kPropNameLatencyReport;
+
+  /**
+   * The property name for the target frame rate, in frames per second.
+   * Redisplays are aligned to its refresh interval (0 to draw frames as
+   * soon as they are requested)
+   */
+  static const PropertyName kPropNameFrameRate;
+
+  /**
+   * The property name for the memory budget of the layers widgets are
+   * cached as, in megabytes
+   */
+  static const PropertyName kPropNameLayerBudget;
+
+  /**
+   * The property name for the file to export the profiler events to, in
+   * Chrome trace format, when the application loop finishes (empty for
+   * none). Events are only recorded if Grog is built with GROG_PROFILE.
+   */
+  static const PropertyName kPropNameProfileTrace;
+
   /**
    * The property value for SDL application engine
    */
   static const PropertyValue kPropValueSDLAppEngine;
 
+  /**
+   * The property value for the headless, software rendered application engine
+   */
+  static const PropertyValue kPropValueSoftwareAppEngine;
+
   GROG_DECL_ERROR(InitError, util::InvalidInputError);
 
   /**
@@ -19,6 +19,8 @@
 #ifndef GROG_UI_COLOR_H
 #define GROG_UI_COLOR_H
 
+#include "grog/util/platform.h"
+
 namespace grog { namespace ui {
 
 struct Color {
@@ -35,6 +37,82 @@ struct Color {
   static Color kRed;
 };
 
+/**
+ * A color packed in 32 bits, with one byte per channel laid out in memory
+ * in RGBA order regardless of the endianness of the platform. This is the
+ * representation shapes store and renderers consume, since it takes a
+ * quarter of the memory of a Color. Conversion from Color may be done at
+ * compile time.
+ */
+struct PackedColor {
+  UInt32 value;
+
+  inline constexpr PackedColor() : value(0) {}
+
+  inline constexpr PackedColor(const Color& color)
+    : value(Pack(Channel(color.r), Channel(color.g),
+                 Channel(color.b), Channel(color.a))) {}
+
+  inline constexpr PackedColor(UInt8 r, UInt8 g, UInt8 b, UInt8 a)
+    : value(Pack(r, g, b, a)) {}
+
+  inline constexpr bool operator == (const PackedColor& c) const {
+    return value == c.value;
+  }
+
+  inline constexpr bool operator != (const PackedColor& c) const {
+    return value != c.value;
+  }
+
+  inline constexpr UInt8 r() const { return Unpack(0); }
+
+  inline constexpr UInt8 g() const { return Unpack(1); }
+
+  inline constexpr UInt8 b() const { return Unpack(2); }
+
+  inline constexpr UInt8 a() const { return Unpack(3); }
+
+  inline constexpr bool opaque() const { return a() == 255; }
+
+  // The packed counterparts of the Color constants
+  static const PackedColor kBlue;
+  static const PackedColor kGreen;
+  static const PackedColor kLightBlue;
+  static const PackedColor kLightGreen;
+  static const PackedColor kLightRed;
+  static const PackedColor kRed;
+
+  /**
+   * Obtain a packed value with given channels in RGBA memory order.
+   */
+  static inline constexpr UInt32 Pack(UInt32 r, UInt32 g, UInt32 b, UInt32 a) {
+#if GROG_ENDIANNESS == GROG_LITTLE_ENDIAN
+    return r | (g << 8) | (b << 16) | (a << 24);
+#else
+    return (r << 24) | (g << 16) | (b << 8) | a;
+#endif
+  }
+
+  /**
+   * Convert a float channel in [0, 1] to a byte, rounding to nearest.
+   */
+  static inline constexpr UInt32 Channel(float value) {
+    return value <= 0.0f ? 0 :
+        value >= 1.0f ? 255 : UInt32(value * 255.0f + 0.5f);
+  }
+
+private:
+
+  // Obtain the channel with given index in memory order
+  inline constexpr UInt8 Unpack(int index) const {
+#if GROG_ENDIANNESS == GROG_LITTLE_ENDIAN
+    return UInt8(value >> (8 * index));
+#else
+    return UInt8(value >> (8 * (3 - index)));
+#endif
+  }
+};
+
 }} // namespace grog::ui
 
 #endif
@@ -0,0 +1,71 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UI_DAMAGE_H
+#define GROG_UI_DAMAGE_H
+
+#include <vector>
+
+#include "grog/ui/euclidean.h"
+
+namespace grog { namespace ui {
+
+/**
+ * A region of the screen that needs to be repainted, represented as a set
+ * of non-overlapping rectangles. Overlapping rectangles are merged as they
+ * are added, and once the number of rectangles exceeds a limit the whole
+ * region collapses into its bounding box, so repainting it never takes
+ * more than a bounded number of passes.
+ */
+class DamageRegion {
+public:
+
+  typedef std::vector<Rect2<int>> RectList;
+
+  inline DamageRegion(unsigned int max_rects = 8) : max_rects_(max_rects) {}
+
+  inline bool empty() const { return rects_.empty(); }
+
+  inline const RectList& rects() const { return rects_; }
+
+  /**
+   * Obtain the bounding box of the damaged region.
+   */
+  Rect2<int> bounds() const;
+
+  /**
+   * Add the given rectangle to the damaged region.
+   */
+  void Add(const Rect2<int>& rect);
+
+  /**
+   * Add all the rectangles of given region to this one.
+   */
+  void Add(const DamageRegion& region);
+
+  inline void Clear() { rects_.clear(); }
+
+private:
+
+  unsigned int max_rects_;
+  RectList rects_;
+};
+
+}} // namespace grog::ui
+
+#endif // GROG_UI_DAMAGE_H
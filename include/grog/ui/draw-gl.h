@@ -20,6 +20,7 @@
 #define GROG_UI_DRAW_GL_H
 
 #include <functional>
+#include <vector>
 
 #include "grog/ui/color.h"
 #include "grog/ui/draw.h"
@@ -41,35 +42,154 @@ public:
   virtual Vector2<int> size() const = 0;
 
   virtual void SwapBuffers() = 0;
+
+  /**
+   * Obtain the address of given OpenGL extension function, or null if it
+   * is not available.
+   */
+  inline virtual void* GetProcAddress(const char* name) { return nullptr; }
+};
+
+struct OpenGLInstancedRenderer;
+
+class OpenGLStateCache;
+
+/**
+ * A batch of primitives pending to be rendered. Rather than issuing GL calls
+ * for each shape, shapes append their quads to the batch when drawn, and
+ * the whole batch is sent to OpenGL with a single draw call when submitted.
+ *
+ * Each quad is stored as a (position, size, color) instance. If an instanced
+ * renderer is set, the instances are drawn as they are with one instanced
+ * call. Otherwise they are expanded into vertices and drawn as a vertex
+ * array.
+ */
+class OpenGLRenderBatch : util::NonCopyable {
+public:
+
+  /**
+   * A quad pending to be rendered.
+   */
+  struct Quad {
+    float x;
+    float y;
+    float w;
+    float h;
+    PackedColor color;
+  };
+
+  /**
+   * Rendering statistics, accumulated since the last reset.
+   */
+  struct Stats {
+    unsigned long draw_calls;
+    unsigned long primitives;
+  };
+
+  /**
+   * Create a batch that sets GL state through given cache.
+   */
+  OpenGLRenderBatch(OpenGLStateCache& state);
+
+  /**
+   * Append a quad filling the given region with given color.
+   */
+  void AddQuad(const Rect2<int>& region, const PackedColor& color);
+
+  /**
+   * Render all pending primitives and empty the batch.
+   */
+  void Submit();
+
+  inline const Stats& stats() const { return stats_; }
+
+  inline void ResetStats() { stats_.draw_calls = stats_.primitives = 0; }
+
+  /**
+   * Obtain the number of primitives added so far, submitted or not. Unlike
+   * stats, it is never reset.
+   */
+  inline unsigned long primitive_count() const { return primitive_count_; }
+
+  /**
+   * Set the renderer used to draw quads as instances, or null to draw them
+   * as a vertex array.
+   */
+  void set_instanced_renderer(const Ptr<OpenGLInstancedRenderer>& renderer);
+
+  inline bool instanced() const { return bool(instanced_renderer_); }
+
+private:
+
+  struct Vertex {
+    float x;
+    float y;
+    PackedColor color;
+  };
+
+  OpenGLStateCache& state_;
+  std::vector<Quad> quads_;
+  std::vector<Vertex> vertices_;
+  Ptr<OpenGLInstancedRenderer> instanced_renderer_;
+  Stats stats_;
+  unsigned long primitive_count_;
+
+  void SubmitVertices();
 };
 
 class OpenGLRectangle : public Rectangle {
 public:
 
-  inline OpenGLRectangle(const Color& color) : color_(color) {}
+  inline OpenGLRectangle(Screen& screen, const PackedColor& color)
+    : screen_(screen), color_(color) {}
 
   virtual void Draw(const Rect2<int>& screen_region) const;
 
 private:
 
-  Color color_;
+  Screen& screen_;
+  PackedColor color_;
 };
 
 class OpenGLShapeFactory : public ShapeFactory {
 public:
 
-  inline virtual Ptr<Rectangle> CreateRectangle(const Color& color) {
-    return new OpenGLRectangle(color);
+  inline OpenGLShapeFactory(Screen& screen) : screen_(screen) {}
+
+  inline virtual Ptr<Rectangle> CreateRectangle(const PackedColor& color) {
+    return new OpenGLRectangle(screen_, color);
   }
+
+private:
+
+  Screen& screen_;
 };
 
+struct OpenGLFramebufferFunctions;
+
 class OpenGLScreen : public Screen {
 public:
 
+  /**
+   * GL state change statistics, accumulated since the last reset. Each state
+   * change requested by the screen is either issued to the driver or
+   * filtered, if the state was already set.
+   */
+  struct StateStats {
+    unsigned long issued;
+    unsigned long filtered;
+  };
+
   OpenGLScreen(const Ptr<OpenGLContext>& ctx);
 
+  virtual ~OpenGLScreen();
+
   virtual Vector2<int> size() const;
 
+  inline virtual Rect2<int> clip() const { return clip_; }
+
+  virtual void set_clip(const Rect2<int>& region);
+
   virtual void Clear();
 
   virtual void Flush();
@@ -78,12 +198,88 @@ public:
     return *shape_factory_;
   }
 
+  /**
+   * Obtain the rendering statistics of this screen.
+   */
+  inline const OpenGLRenderBatch::Stats& stats() const {
+    return batch_.stats();
+  }
+
+  inline void ResetStats() { batch_.ResetStats(); }
+
+  /**
+   * Obtain the statistics of the GL state changes of this screen.
+   */
+  const StateStats& state_stats() const;
+
+  void ResetStateStats();
+
+  /**
+   * Forget the GL state known by this screen, so it is set again when
+   * needed. Code issuing GL calls on its own must invalidate the state
+   * before the screen draws again.
+   */
+  void InvalidateState();
+
+  inline virtual unsigned long primitive_count() const {
+    return batch_.primitive_count();
+  }
+
+  /**
+   * Create a layer of given size, backed by a texture attached to a frame
+   * buffer object. Layers are not supported, and null is returned, if the
+   * driver lacks EXT_framebuffer_object.
+   */
+  virtual Ptr<Layer> CreateLayer(const Vector2<int>& size);
+
+  virtual std::size_t LayerMemorySize(const Vector2<int>& size) const;
+
+  virtual void DrawLayer(const Layer& layer, const Vector2<int>& pos);
+
+  /**
+   * Check whether the driver supports drawing rectangles as instances, which
+   * requires ARB_instanced_arrays, ARB_draw_instanced and GLSL shaders.
+   */
+  inline bool instancing_supported() const {
+    return bool(instanced_renderer_);
+  }
+
+  /**
+   * Check whether rectangles are drawn with a single instanced call per
+   * batch, rather than as a batched vertex array.
+   */
+  inline bool instancing() const { return batch_.instanced(); }
+
+  /**
+   * Enable or disable the instanced rendering of rectangles. It is enabled
+   * by default if supported, and cannot be enabled otherwise.
+   */
+  void set_instancing(bool enabled);
+
+protected:
+
+  inline virtual void RenderFill(const Rect2<int>& region,
+                                 const PackedColor& color) {
+    batch_.AddQuad(region, color);
+  }
+
+  virtual void SetTarget(Layer* layer, const Vector2<int>& origin);
+
 private:
 
   Ptr<OpenGLContext> ctx_;
+  Ptr<OpenGLStateCache> state_;
+  OpenGLRenderBatch batch_;
   Ptr<OpenGLShapeFactory> shape_factory_;
+  Rect2<int> clip_;
+  Ptr<OpenGLFramebufferFunctions> fbo_;
+  Ptr<OpenGLInstancedRenderer> instanced_renderer_;
+  Layer* target_;
+  Rect2<int> target_region_;
 
   void Init2DState();
+
+  void SetProjection(const Rect2<int>& region);
 };
 
 }} // namespace grog::ui
@@ -58,6 +58,8 @@ public:
 
   virtual void SwapBuffers();
 
+  virtual void* GetProcAddress(const char* name);
+
 private:
 
   SDL_Surface* screen_;
@@ -0,0 +1,134 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UI_DRAW_SOFT_H
+#define GROG_UI_DRAW_SOFT_H
+
+#include <vector>
+
+#include "grog/ui/color.h"
+#include "grog/ui/draw.h"
+#include "grog/util/lang.h"
+#include "grog/util/platform.h"
+
+namespace grog { namespace ui {
+
+class SoftwareScreen;
+
+class SoftwareRectangle : public Rectangle {
+public:
+
+  inline SoftwareRectangle(SoftwareScreen& screen, const PackedColor& color)
+    : screen_(screen), color_(color) {}
+
+  virtual void Draw(const Rect2<int>& screen_region) const;
+
+private:
+
+  SoftwareScreen& screen_;
+  PackedColor color_;
+};
+
+class SoftwareShapeFactory : public ShapeFactory {
+public:
+
+  inline SoftwareShapeFactory(SoftwareScreen& screen) : screen_(screen) {}
+
+  inline virtual Ptr<Rectangle> CreateRectangle(const PackedColor& color) {
+    return new SoftwareRectangle(screen_, color);
+  }
+
+private:
+
+  SoftwareScreen& screen_;
+};
+
+/**
+ * A screen rendered by the CPU into an in-memory framebuffer. It requires
+ * neither a GPU nor a window system, so it may be used to draw and measure
+ * widgets on headless machines.
+ *
+ * Pixels are stored in RGBA order, one byte per channel, row by row from
+ * the top-left corner of the screen.
+ */
+class SoftwareScreen : public Screen {
+public:
+
+  SoftwareScreen(const Vector2<int>& size);
+
+  inline virtual Vector2<int> size() const { return size_; }
+
+  inline virtual Rect2<int> clip() const { return clip_; }
+
+  virtual void set_clip(const Rect2<int>& region);
+
+  virtual void Clear();
+
+  virtual void Flush();
+
+  inline virtual SoftwareShapeFactory& shape_factory() {
+    return shape_factory_;
+  }
+
+  /**
+   * Obtain the framebuffer pixels, as they were on the last flush.
+   */
+  inline const std::vector<UInt32>& pixels() const { return front_buffer_; }
+
+  /**
+   * Obtain the number of frames flushed so far.
+   */
+  inline unsigned long frame_count() const { return frame_count_; }
+
+  inline virtual unsigned long primitive_count() const {
+    return primitive_count_;
+  }
+
+  /**
+   * Create a layer of given size. Layers hold premultiplied pixels, so
+   * translucent shapes drawn on them are composited as they would have
+   * been drawn.
+   */
+  virtual Ptr<Layer> CreateLayer(const Vector2<int>& size);
+
+  virtual void DrawLayer(const Layer& layer, const Vector2<int>& pos);
+
+protected:
+
+  virtual void RenderFill(const Rect2<int>& region, const PackedColor& color);
+
+  virtual void SetTarget(Layer* layer, const Vector2<int>& origin);
+
+private:
+
+  Vector2<int> size_;
+  Rect2<int> clip_;
+  std::vector<UInt32> back_buffer_;
+  std::vector<UInt32> front_buffer_;
+  unsigned long frame_count_;
+  unsigned long primitive_count_;
+  SoftwareShapeFactory shape_factory_;
+
+  // The pixels drawing goes to, either the back buffer or a layer
+  UInt32* target_;
+  Rect2<int> target_region_;
+};
+
+}} // namespace grog::ui
+
+#endif // GROG_UI_DRAW_SOFT_H
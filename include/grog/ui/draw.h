@@ -19,6 +19,12 @@
 #ifndef GROG_UI_DRAW_H
 #define GROG_UI_DRAW_H
 
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "grog/ui/color.h"
 #include "grog/ui/euclidean.h"
 #include "grog/util/lang.h"
@@ -40,21 +46,289 @@ public:
 
   inline virtual ~ShapeFactory() {}
 
-  virtual Ptr<Rectangle> CreateRectangle(const Color& color) = 0;
+  virtual Ptr<Rectangle> CreateRectangle(const PackedColor& color) = 0;
+};
+
+/**
+ * The fills drawn on a screen while recording, so they may be drawn again
+ * by replaying them rather than by drawing whatever issued them. Regions
+ * are relative to the origin the list was recorded at.
+ */
+class DrawCommandList {
+public:
+
+  struct Fill {
+    Rect2<int> region;
+    PackedColor color;
+  };
+
+  inline void AddFill(const Rect2<int>& region, const PackedColor& color) {
+    Fill fill = { region, color };
+    fills_.push_back(fill);
+  }
+
+  inline const std::vector<Fill>& fills() const { return fills_; }
+
+  inline bool empty() const { return fills_.empty(); }
+
+  inline void Clear() { fills_.clear(); }
+
+private:
+
+  std::vector<Fill> fills_;
+};
+
+/**
+ * An offscreen surface that may be drawn on like the screen, and then
+ * composited onto it. Layers are created by the screen they belong to.
+ */
+class Layer : util::NonCopyable {
+public:
+
+  inline Layer(const Vector2<int>& size, std::size_t memory_size)
+    : size_(size), memory_size_(memory_size) {}
+
+  inline virtual ~Layer() {}
+
+  inline Vector2<int> size() const { return size_; }
+
+  /**
+   * Obtain the number of bytes of memory the layer takes.
+   */
+  inline std::size_t memory_size() const { return memory_size_; }
+
+private:
+
+  Vector2<int> size_;
+  std::size_t memory_size_;
+};
+
+class Screen;
+
+/**
+ * The layers of a screen, each owned by an object that draws on it. The
+ * memory the layers take is bounded by a budget: when creating a layer
+ * would exceed it, the least recently used layers are dropped.
+ */
+class LayerCache : util::NonCopyable {
+public:
+
+  struct Stats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+  };
+
+  static const std::size_t kDefaultBudget = 64 * 1024 * 1024;
+
+  inline LayerCache(Screen& screen, std::size_t budget = kDefaultBudget)
+    : screen_(screen), budget_(budget), memory_usage_(0) { ResetStats(); }
+
+  /**
+   * Find the layer of given owner, which becomes the most recently used.
+   * It returns null if the owner has no layer, e.g., because it was
+   * dropped.
+   */
+  Ptr<Layer> Find(const void* owner);
+
+  /**
+   * Create a new layer of given size for given owner, replacing any layer
+   * it had. It returns null if the screen doesn't support layers or the
+   * layer wouldn't fit in the budget, in which case nothing is allocated.
+   */
+  Ptr<Layer> Create(const void* owner, const Vector2<int>& size);
+
+  /**
+   * Drop the layer of given owner, if any.
+   */
+  void Release(const void* owner);
+
+  void Clear();
+
+  inline std::size_t budget() const { return budget_; }
+
+  /**
+   * Set the memory budget, dropping the layers that no longer fit.
+   */
+  void set_budget(std::size_t budget);
+
+  inline std::size_t memory_usage() const { return memory_usage_; }
+
+  inline std::size_t size() const { return layers_.size(); }
+
+  inline const Stats& stats() const { return stats_; }
+
+  inline void ResetStats() {
+    stats_.hits = stats_.misses = stats_.evictions = 0;
+  }
+
+private:
+
+  // Layers from the most to the least recently used
+  typedef std::list<std::pair<const void*, Ptr<Layer>>> LayerList;
+
+  Screen& screen_;
+  std::size_t budget_;
+  std::size_t memory_usage_;
+  LayerList layers_;
+  std::unordered_map<const void*, LayerList::iterator> index_;
+  Stats stats_;
+
+  void Evict(std::size_t memory);
 };
 
 class Screen {
 public:
 
+  inline Screen() : layer_cache_(*this) {}
+
   inline virtual ~Screen() {}
 
   virtual Vector2<int> size() const = 0;
 
+  /**
+   * Obtain the region of the screen drawing operations are restricted to.
+   */
+  virtual Rect2<int> clip() const = 0;
+
+  /**
+   * Restrict drawing operations, including Clear(), to given region of the
+   * screen. Pixels out of the clip region are left untouched.
+   */
+  virtual void set_clip(const Rect2<int>& region) = 0;
+
+  /**
+   * Remove any clip region, so the whole screen may be drawn.
+   */
+  inline void ResetClip() {
+    set_clip(Rect2<int>(Vector2<int>(0, 0), size()));
+  }
+
   virtual void Clear() = 0;
 
   virtual void Flush() = 0;
 
   virtual ShapeFactory& shape_factory() = 0;
+
+  /**
+   * Obtain the number of primitives drawn on this screen so far, or zero
+   * if the screen doesn't count them. The count only grows, so the
+   * primitives drawn by an operation are the difference of the counts
+   * before and after it.
+   */
+  inline virtual unsigned long primitive_count() const { return 0; }
+
+  /**
+   * Fill the given region, restricted to the clip region, with given color.
+   * Translucent colors are blended over the current contents, which every
+   * screen must honour. While recording, the fill is added to the recorded
+   * list instead.
+   */
+  inline void FillRect(const Rect2<int>& region, const PackedColor& color) {
+    if (recordings_.empty()) {
+      RenderFill(region, color);
+    } else {
+      auto& rec = recordings_.back();
+      rec.list->AddFill(Rect2<int>(region.x - rec.region.x,
+                                   region.y - rec.region.y,
+                                   region.w, region.h), color);
+    }
+  }
+
+  /**
+   * Record the fills drawn from now on into given list rather than drawing
+   * them, relative to the position of given region. The clip region is set
+   * to the given one while recording, so the list holds everything drawn
+   * on the region regardless of the clip in effect. Recordings may be
+   * nested.
+   */
+  void BeginRecording(DrawCommandList& list, const Rect2<int>& region);
+
+  /**
+   * Stop the innermost recording, restoring the clip region it replaced.
+   */
+  void EndRecording();
+
+  inline bool recording() const { return !recordings_.empty(); }
+
+  /**
+   * Draw the fills of given list, relative to given position. If a list is
+   * being recorded, they are added to it instead.
+   */
+  void Replay(const DrawCommandList& list, const Vector2<int>& pos);
+
+  /**
+   * Create a transparent layer of given size, or null if this screen
+   * doesn't support layers. Layers should rather be obtained from the
+   * layer cache, so the memory they take is accounted.
+   */
+  inline virtual Ptr<Layer> CreateLayer(const Vector2<int>& size) {
+    return nullptr;
+  }
+
+  /**
+   * Obtain the bytes of memory a layer of given size would take, so the
+   * layers that wouldn't fit in a budget are not even created.
+   */
+  inline virtual std::size_t LayerMemorySize(const Vector2<int>& size) const {
+    return std::size_t(size.x) * size.y * 4;
+  }
+
+  inline LayerCache& layer_cache() { return layer_cache_; }
+
+  /**
+   * Draw on given layer rather than on the screen, until EndLayer(). The
+   * layer stands for given region of the screen, so drawing coordinates
+   * are still screen coordinates. The clip region is set to the given one
+   * meanwhile. Layers may be nested.
+   */
+  void BeginLayer(Layer& layer, const Rect2<int>& region);
+
+  /**
+   * Stop drawing on the innermost layer, restoring the clip region it
+   * replaced.
+   */
+  void EndLayer();
+
+  /**
+   * Composite given layer at given position, restricted to the clip
+   * region. Layer pixels are blended over the current contents, so a layer
+   * looks as what was drawn on it would have looked if drawn directly. The
+   * pixels of the layer nothing was drawn on are left untouched.
+   */
+  inline virtual void DrawLayer(const Layer& layer, const Vector2<int>& pos) {}
+
+protected:
+
+  /**
+   * Actually fill the given region, restricted to the clip region.
+   */
+  virtual void RenderFill(const Rect2<int>& region,
+                          const PackedColor& color) = 0;
+
+  /**
+   * Direct drawing to given layer, whose top-left corner stands for given
+   * position of the screen, or to the screen itself if layer is null.
+   */
+  inline virtual void SetTarget(Layer* layer, const Vector2<int>& origin) {}
+
+private:
+
+  struct Recording {
+    DrawCommandList* list;
+    Rect2<int> region;
+    Rect2<int> clip;
+  };
+
+  struct Target {
+    Layer* layer;
+    Rect2<int> region;
+    Rect2<int> clip;
+  };
+
+  std::vector<Recording> recordings_;
+  std::vector<Target> targets_;
+  LayerCache layer_cache_;
 };
 
 }} // namespace grog::ui
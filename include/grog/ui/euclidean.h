@@ -57,6 +57,14 @@ struct Rect2 {
     return Rect2(x + rect.x, y + rect.y, rect.w, rect.h);
   }
 
+  inline bool operator == (const Rect2& rect) const {
+    return x == rect.x && y == rect.y && w == rect.w && h == rect.h;
+  }
+
+  inline bool operator != (const Rect2& rect) const {
+    return !(*this == rect);
+  }
+
   inline Vector2<PT> position() const { return Vector2<PT>(x, y); }
 
   inline void set_position(const Vector2<PT>& pos) {
@@ -67,6 +75,53 @@ struct Rect2 {
   inline bool Wrap(const Vector2<PT>& p) const {
     return x <= p.x && p.x <= x + w && y <= p.y && p.y <= y + h;
   }
+
+  inline bool empty() const { return w <= 0 || h <= 0; }
+
+  inline ST area() const { return empty() ? ST(0) : w * h; }
+
+  /**
+   * Check whether this rectangle overlaps with given one.
+   */
+  inline bool Intersects(const Rect2& rect) const {
+    return x < rect.x + rect.w && rect.x < x + w &&
+           y < rect.y + rect.h && rect.y < y + h;
+  }
+
+  /**
+   * Check whether given rectangle lies entirely within this one.
+   */
+  inline bool Contains(const Rect2& rect) const {
+    return x <= rect.x && rect.x + rect.w <= x + w &&
+           y <= rect.y && rect.y + rect.h <= y + h;
+  }
+
+  /**
+   * Obtain the overlapping region of this rectangle and given one. The
+   * result is empty if they do not intersect.
+   */
+  inline Rect2 Intersection(const Rect2& rect) const {
+    PT x0 = MAX(x, rect.x);
+    PT y0 = MAX(y, rect.y);
+    PT x1 = MIN(x + w, rect.x + rect.w);
+    PT y1 = MIN(y + h, rect.y + rect.h);
+    return Rect2(x0, y0, MAX(x1 - x0, 0), MAX(y1 - y0, 0));
+  }
+
+  /**
+   * Obtain the smallest rectangle containing both this one and given one.
+   */
+  inline Rect2 Union(const Rect2& rect) const {
+    if (empty())
+      return rect;
+    if (rect.empty())
+      return *this;
+    PT x0 = MIN(x, rect.x);
+    PT y0 = MIN(y, rect.y);
+    PT x1 = MAX(x + w, rect.x + rect.w);
+    PT y1 = MAX(y + h, rect.y + rect.h);
+    return Rect2(x0, y0, x1 - x0, y1 - y0);
+  }
 };
 
 }} // namespace grog::ui
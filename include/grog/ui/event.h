@@ -19,10 +19,11 @@
 #ifndef GROG_UI_EVENT_H
 #define GROG_UI_EVENT_H
 
+#include <chrono>
 #include <functional>
-#include <list>
 
 #include "grog/ui/euclidean.h"
+#include "grog/util/handler.h"
 
 namespace grog { namespace ui {
 
@@ -41,12 +42,20 @@ enum MouseButtonState {
   kUnknownMouseState,
 };
 
+/**
+ * The time an input event was received from the window system. A default
+ * constructed time means unknown.
+ */
+typedef std::chrono::steady_clock::time_point EventTime;
+
 struct MouseMotionEvent {
   Vector2<int> abs_pos;
   Vector2<int>rel_pos;
+  EventTime time;
 
-  inline MouseMotionEvent(const Vector2<int>& abs, const Vector2<int>& rel)
-    : abs_pos(abs), rel_pos(rel) {}
+  inline MouseMotionEvent(const Vector2<int>& abs, const Vector2<int>& rel,
+                          const EventTime& time = EventTime())
+    : abs_pos(abs), rel_pos(rel), time(time) {}
 };
 
 struct MouseButtonEvent {
@@ -54,10 +63,21 @@ struct MouseButtonEvent {
   MouseButtonState state;
   Vector2<int> pos;
 
+  /**
+   * The number of clicks this event stands for. It is greater than one
+   * for wheel buttons when a burst of wheel ticks was folded into a single
+   * event, so it works as a scroll delta.
+   */
+  unsigned int clicks;
+
+  EventTime time;
+
   inline MouseButtonEvent(const MouseButton& button,
                           const MouseButtonState& state,
-                          const Vector2<int>& pos)
-    : button(button), state(state), pos(pos) {}
+                          const Vector2<int>& pos,
+                          unsigned int clicks = 1,
+                          const EventTime& time = EventTime())
+    : button(button), state(state), pos(pos), clicks(clicks), time(time) {}
 };
 
 typedef std::function<void(const MouseMotionEvent&)> MouseMotionEventHandler;
@@ -71,42 +91,72 @@ typedef std::function<void(void)> FrameDrawnEventHandler;
 class EventProducer {
 public:
 
-  virtual void RegisterMouseMotionEventHandler(
+  /**
+   * Register a handler for mouse motion events, returning the token to
+   * unregister it.
+   */
+  virtual util::HandlerToken RegisterMouseMotionEventHandler(
       const MouseMotionEventHandler& handler) = 0;
 
-  virtual void RegisterMouseButtonEventHandler(
+  /**
+   * Register a handler for mouse button events, returning the token to
+   * unregister it.
+   */
+  virtual util::HandlerToken RegisterMouseButtonEventHandler(
       const MouseButtonEventHandler& handler) = 0;
+
+  /**
+   * Unregister the mouse motion event handler identified by given token.
+   * This may be invoked from a handler while an event is being dispatched.
+   */
+  virtual void UnregisterMouseMotionEventHandler(
+      const util::HandlerToken& token) = 0;
+
+  /**
+   * Unregister the mouse button event handler identified by given token.
+   * This may be invoked from a handler while an event is being dispatched.
+   */
+  virtual void UnregisterMouseButtonEventHandler(
+      const util::HandlerToken& token) = 0;
 };
 
 class AbstractEventProducer : public EventProducer {
 public:
 
-  inline virtual void RegisterMouseMotionEventHandler(
+  inline virtual util::HandlerToken RegisterMouseMotionEventHandler(
       const MouseMotionEventHandler& handler) {
-    mouse_motion_handlers_.push_back(handler);
+    return mouse_motion_handlers_.Add(handler);
   }
 
-  inline virtual void RegisterMouseButtonEventHandler(
+  inline virtual util::HandlerToken RegisterMouseButtonEventHandler(
       const MouseButtonEventHandler& handler) {
-    mouse_button_handlers_.push_back(handler);
+    return mouse_button_handlers_.Add(handler);
+  }
+
+  inline virtual void UnregisterMouseMotionEventHandler(
+      const util::HandlerToken& token) {
+    mouse_motion_handlers_.Remove(token);
+  }
+
+  inline virtual void UnregisterMouseButtonEventHandler(
+      const util::HandlerToken& token) {
+    mouse_button_handlers_.Remove(token);
   }
 
 protected:
 
   void HandleMouseMotionEvent(const MouseMotionEvent& event) {
-    for (auto& handler : mouse_motion_handlers_)
-      handler(event);
+    mouse_motion_handlers_.Dispatch(event);
   }
 
   void HandleMouseButtonEvent(const MouseButtonEvent& event) {
-    for (auto& handler : mouse_button_handlers_)
-      handler(event);
+    mouse_button_handlers_.Dispatch(event);
   }
 
 private:
 
-  std::list<MouseMotionEventHandler> mouse_motion_handlers_;
-  std::list<MouseButtonEventHandler> mouse_button_handlers_;
+  util::HandlerTable<MouseMotionEventHandler> mouse_motion_handlers_;
+  util::HandlerTable<MouseButtonEventHandler> mouse_button_handlers_;
 };
 
 }} // namespace grog::ui
@@ -20,8 +20,12 @@
 #define GROG_UI_LAYOUT_H
 
 #include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "grog/ui/app.h"
+#include "grog/ui/spatial.h"
 #include "grog/ui/widget.h"
 #include "grog/ui/mouse.h"
 #include "grog/util/lang.h"
@@ -47,25 +51,71 @@ public:
 
   inline virtual ~Layout() {}
 
-  virtual Option<WidgetPlacement> Find(
+  /**
+   * Find the first child matching given predicate. The returned placement
+   * belongs to the layout and remains valid until its children are
+   * modified.
+   */
+  virtual Option<const WidgetPlacement&> Find(
       const WidgetPlacement::Predicate& predicate) = 0;
 
   void Find(const WidgetPlacement::Predicate& predicate,
             const WidgetPlacement::Action& action);
 
-  Option<Widget> FindWidget(const WidgetPlacement::Predicate& predicate);
+  Option<Widget&> FindWidget(const WidgetPlacement::Predicate& predicate);
+
+  /**
+   * Apply given action to every child. The default implementation visits
+   * them through Find(), layouts may override it to iterate directly.
+   */
+  virtual void ForEach(const WidgetPlacement::Action& action);
+
+  /**
+   * Find the front-most child placed on given position. This is equivalent
+   * to Find(OnPosition(pos)), but layouts may override it to avoid
+   * checking every child.
+   */
+  virtual Option<const WidgetPlacement&> FindAt(const Vector2<int>& pos);
+
+  void FindAt(const Vector2<int>& pos, const WidgetPlacement::Action& action);
+
+  Option<Widget&> FindWidgetAt(const Vector2<int>& pos);
 };
 
 class FixedLayout : public Layout, public DelegatedMouseResponder {
 public:
 
+  /**
+   * Counters of the children considered by Draw(). Children out of the
+   * clip region or hidden behind opaque siblings are culled, the rest are
+   * drawn.
+   */
+  struct CullStats {
+    unsigned long drawn;
+    unsigned long offscreen;
+    unsigned long occluded;
+
+    inline CullStats() : drawn(0), offscreen(0), occluded(0) {}
+  };
+
   FixedLayout(const Ptr<ApplicationContext>& ctx = nullptr);
 
+  virtual ~FixedLayout();
+
   virtual void Draw(const Rect2<int>& screen_region) const;
 
-  virtual Option<WidgetPlacement> Find(
+  virtual Option<const WidgetPlacement&> Find(
       const WidgetPlacement::Predicate& predicate);
 
+  virtual void ForEach(const WidgetPlacement::Action& action);
+
+  virtual Option<const WidgetPlacement&> FindAt(const Vector2<int>& pos);
+
+  /**
+   * Add given widget on given region, behind the children added so far. A
+   * widget already in the layout is moved there instead, as a layout can't
+   * hold the same widget twice.
+   */
   FixedLayout& AddWidget(const Ptr<Widget>& widget,
                          const Rect2<int>& region);
 
@@ -73,11 +123,66 @@ public:
 
   void BringToFront(const Ptr<Widget>& widget);
 
+  /**
+   * Skip drawing the children fully covered by opaque siblings in front of
+   * them. It is disabled by default, since it only pays off when opaque
+   * children overlap.
+   */
+  inline void set_occlusion_culling(bool value) { occlusion_culling_ = value; }
+
+  inline bool occlusion_culling() const { return occlusion_culling_; }
+
+  inline const CullStats& cull_stats() const { return cull_stats_; }
+
+  inline void ResetCullStats() { cull_stats_ = CullStats(); }
+
 private:
 
   typedef std::list<WidgetPlacement> WidgetPlacementList;
 
+  /*
+   * A child as registered in the spatial index. Its depth grows towards the
+   * front, so the front-most of several overlapping children is the one
+   * with greatest depth.
+   */
+  struct IndexEntry {
+    WidgetPlacementList::iterator child;
+    long depth;
+
+    inline bool operator == (const IndexEntry& e) const {
+      return child == e.child;
+    }
+  };
+
+  // Children in z-order, front-most first
   WidgetPlacementList children_;
+  std::unordered_map<const Widget*, IndexEntry> entries_;
+  GridIndex<IndexEntry> index_;
+  long front_depth_;
+  long back_depth_;
+
+  /*
+   * The screen region this layout was drawn on in the last frame, used to
+   * translate the location of children into damaged screen regions.
+   */
+  mutable Rect2<int> screen_region_;
+  mutable bool drawn_;
+
+  bool occlusion_culling_;
+  mutable CullStats cull_stats_;
+
+  // Scratch buffers of Draw(), kept to avoid allocating every frame
+  mutable std::vector<IndexEntry> candidates_;
+  mutable std::vector<const WidgetPlacement*> visible_;
+  mutable std::vector<Rect2<int>> occluders_;
+
+  void CollectVisible(const Rect2<int>& region) const;
+
+  void CullOccluded(const Rect2<int>& region) const;
+
+  void PostRedisplayChild(const Rect2<int>& location);
+
+  IndexEntry* EntryOf(const Ptr<Widget>& widget);
 
   void ForWidgetOn(const Vector2<int>& pos,
                    const std::function<void(const WidgetPlacement&)>& action);
@@ -91,6 +196,133 @@ private:
               const Vector2<int>& mov);
 };
 
+/**
+ * A layout that shows a vertical list of rows of equal height, scrolled by
+ * the mouse wheel. Row widgets are created on demand by a factory invoked
+ * with the row index, only for the rows in sight, and are dropped once
+ * scrolled out of sight. Hence drawing, hit-testing and scrolling cost the
+ * same no matter how many rows the list has. Rows are as wide as the
+ * region the layout is drawn on, and the rows in sight are only known once
+ * the layout has been drawn.
+ */
+class ScrollLayout : public Layout, public DelegatedMouseResponder {
+public:
+
+  typedef std::function<Ptr<Widget>(std::size_t row)> RowFactory;
+
+  /**
+   * Create a layout of given number of rows, each one of given height in
+   * pixels. Heights below one pixel are taken as one.
+   */
+  ScrollLayout(const RowFactory& factory,
+               std::size_t row_count,
+               int row_height,
+               const Ptr<ApplicationContext>& ctx = nullptr);
+
+  virtual ~ScrollLayout();
+
+  virtual void Draw(const Rect2<int>& screen_region) const;
+
+  virtual bool Respond(const MouseButtonEvent& ev);
+
+  virtual bool Respond(const MouseMotionEvent& ev);
+
+  virtual Option<const WidgetPlacement&> Find(
+      const WidgetPlacement::Predicate& predicate);
+
+  virtual void ForEach(const WidgetPlacement::Action& action);
+
+  virtual Option<const WidgetPlacement&> FindAt(const Vector2<int>& pos);
+
+  inline std::size_t row_count() const { return row_count_; }
+
+  /**
+   * Set the number of rows. The widgets of the rows kept are reused.
+   */
+  void set_row_count(std::size_t count);
+
+  inline int row_height() const { return row_height_; }
+
+  /**
+   * Obtain how far the list is scrolled, in pixels from its top.
+   */
+  inline long scroll_offset() const { return offset_; }
+
+  /**
+   * Scroll the list to given offset, clamped so the viewport never goes
+   * past the last row.
+   */
+  void ScrollTo(long offset);
+
+  inline void ScrollBy(long delta) { ScrollTo(offset_ + delta); }
+
+  /**
+   * Drop the widgets of the rows in sight, so they are created again by
+   * the factory. This is meant for when the data they show changes.
+   */
+  void InvalidateRows();
+
+  /**
+   * Obtain the number of row widgets currently created.
+   */
+  inline std::size_t materialized_count() const { return rows_.size(); }
+
+private:
+
+  typedef std::vector<WidgetPlacement> WidgetPlacementList;
+
+  RowFactory factory_;
+  std::size_t row_count_;
+  int row_height_;
+  long offset_;
+
+  /*
+   * The rows in sight, starting with first_row_. They are updated from
+   * Draw() when the size of the layout changes, hence mutable.
+   */
+  mutable WidgetPlacementList rows_;
+  mutable WidgetPlacementList scratch_rows_;
+  mutable std::size_t first_row_;
+  mutable Vector2<int> viewport_;
+  mutable Rect2<int> screen_region_;
+  mutable bool drawn_;
+
+  long max_offset() const;
+
+  void Materialize() const;
+
+  /*
+   * Clear the parent of the row widgets, which may be kept by the factory
+   * once dropped.
+   */
+  void ReleaseRows() const;
+
+  void PostRedisplayViewport();
+};
+
+/**
+ * A debugging aid that draws a layout and shades each of its children
+ * after the share of the layout draw time it took. The hotter a child is
+ * shaded, the more it costs to draw. Widget draw stats must be enabled for
+ * the overlay to show anything.
+ */
+class DrawCostOverlay : public WrapperWidget {
+public:
+
+  inline DrawCostOverlay(const Ptr<ApplicationContext>& ctx,
+                         const Ptr<Layout>& layout)
+    : WrapperWidget(ctx), layout_(layout) { set_child(layout); }
+
+  virtual void Draw(const Rect2<int>& screen_region) const;
+
+private:
+
+  Ptr<Layout> layout_;
+
+  // Scratch buffer of Draw(), kept to avoid allocating every frame
+  mutable std::vector<std::pair<Rect2<int>, double>> costs_;
+};
+
 }} // namespace grog::ui
 
 #endif
@@ -168,8 +168,7 @@ public:
   inline DragAndDropResponder(
       const OnDragHandler& on_drag,
       const OnDropHandler& on_drop)
-    : on_drag_(on_drag), on_drop_(on_drop), draging_(Option<Widget>::None()),
-      draging_from_(0, 0) {
+    : on_drag_(on_drag), on_drop_(on_drop), draging_from_(0, 0) {
   }
 
   virtual bool Respond(Layout& layout, const MouseButtonEvent& ev);
@@ -180,7 +179,8 @@ private:
 
   OnDragHandler on_drag_;
   OnDropHandler on_drop_;
-  Option<Widget> draging_;
+  // Kept alive while dragged, even if removed from the layout meanwhile
+  Ptr<Widget> draging_;
   Vector2<int> draging_from_;
 };
 
@@ -0,0 +1,101 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UI_PIXEL_H
+#define GROG_UI_PIXEL_H
+
+#include <cstddef>
+
+#include "grog/ui/color.h"
+#include "grog/util/lang.h"
+#include "grog/util/platform.h"
+
+namespace grog { namespace ui {
+
+enum PixelInstructionSet {
+  kScalarInstructionSet,
+  kSSE2InstructionSet,
+  kAVX2InstructionSet,
+};
+
+/**
+ * A set of kernels that process spans of RGBA8 pixels, i.e., pixels with
+ * one byte per channel laid out in memory in RGBA order. All the kernels
+ * produce exactly the same results, they only differ in the instruction set
+ * they are implemented with.
+ */
+struct PixelKernels {
+
+  PixelInstructionSet instruction_set;
+
+  /**
+   * Set the first len pixels of dst to given pixel.
+   */
+  void (*fill_span)(UInt32* dst, std::size_t len, UInt32 pixel);
+
+  /**
+   * Blend given pixel over the first len pixels of dst, using the source
+   * over operator with the alpha channel of the pixel. The pixel is not
+   * premultiplied.
+   */
+  void (*blend_span)(UInt32* dst, std::size_t len, UInt32 pixel);
+
+  /**
+   * Obtain the fastest kernels supported by the host CPU. They are detected
+   * on first use.
+   */
+  static const PixelKernels& Best();
+
+  /**
+   * Obtain the kernels implemented with given instruction set, or none if
+   * either the build or the host CPU doesn't support it.
+   */
+  static Option<const PixelKernels&> ForInstructionSet(
+      PixelInstructionSet instruction_set);
+};
+
+/**
+ * Pack the channels of a pixel so that they are laid out in memory in RGBA
+ * order, regardless of the endianness of the platform.
+ */
+inline constexpr UInt32 PackPixel(UInt32 r, UInt32 g, UInt32 b, UInt32 a) {
+  return PackedColor::Pack(r, g, b, a);
+}
+
+inline constexpr UInt32 PackPixel(const Color& color) {
+  return PackedColor(color).value;
+}
+
+/**
+ * Fill a span of pixels using the fastest kernel for the host CPU.
+ */
+inline void FillSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  PixelKernels::Best().fill_span(dst, len, pixel);
+}
+
+/**
+ * Blend a pixel over a span of pixels using the fastest kernel for the host
+ * CPU.
+ */
+inline void BlendSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  PixelKernels::Best().blend_span(dst, len, pixel);
+}
+
+}} // namespace grog::ui
+
+#endif // GROG_UI_PIXEL_H
@@ -0,0 +1,151 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UI_SPATIAL_H
+#define GROG_UI_SPATIAL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "grog/ui/euclidean.h"
+
+namespace grog { namespace ui {
+
+/**
+ * A spatial index based on a uniform grid. Each item is registered in every
+ * cell its region overlaps, so a point query only has to check the items
+ * of the cell the point falls in, regardless of the total number of items.
+ * Regions are considered to include their right and bottom edges, as
+ * Rect2::Wrap() does.
+ */
+template <typename T>
+class GridIndex {
+public:
+
+  inline GridIndex(int cell_size = 64) : cell_size_(cell_size) {}
+
+  /**
+   * Register the given item as covering given region.
+   */
+  void Insert(const T& item, const Rect2<int>& region) {
+    ForEachCell(region, [&item](Cell& cell) {
+      cell.push_back(item);
+    });
+  }
+
+  /**
+   * Unregister the given item, which must have been inserted with the
+   * same region.
+   */
+  void Remove(const T& item, const Rect2<int>& region) {
+    int cx0 = CellOf(region.x), cx1 = CellOf(region.x + region.w);
+    int cy0 = CellOf(region.y), cy1 = CellOf(region.y + region.h);
+    for (int cx = cx0; cx <= cx1; cx++) {
+      for (int cy = cy0; cy <= cy1; cy++) {
+        auto cell = cells_.find(CellKey(cx, cy));
+        if (cell == cells_.end())
+          continue;
+        auto& items = cell->second;
+        auto it = std::find(items.begin(), items.end(), item);
+        if (it != items.end()) {
+          *it = items.back();
+          items.pop_back();
+        }
+        if (items.empty())
+          cells_.erase(cell);
+      }
+    }
+  }
+
+  /**
+   * Invoke the given action for each item whose region might contain given
+   * point. Items are not visited in any particular order, and some of them
+   * may not actually contain the point.
+   */
+  template <typename Action>
+  void ForEachCandidate(const Vector2<int>& point, Action action) const {
+    auto cell = cells_.find(CellKey(CellOf(point.x), CellOf(point.y)));
+    if (cell != cells_.end()) {
+      for (auto& item : cell->second)
+        action(item);
+    }
+  }
+
+  /**
+   * Invoke the given action for each item whose region might intersect
+   * given region. Items are not visited in any particular order, and an
+   * item is visited once per cell it shares with the region.
+   */
+  template <typename Action>
+  void ForEachCandidate(const Rect2<int>& region, Action action) const {
+    int cx0 = CellOf(region.x), cx1 = CellOf(region.x + region.w);
+    int cy0 = CellOf(region.y), cy1 = CellOf(region.y + region.h);
+    for (int cx = cx0; cx <= cx1; cx++) {
+      for (int cy = cy0; cy <= cy1; cy++) {
+        auto cell = cells_.find(CellKey(cx, cy));
+        if (cell != cells_.end()) {
+          for (auto& item : cell->second)
+            action(item);
+        }
+      }
+    }
+  }
+
+  /**
+   * Obtain the number of cells a region query would visit.
+   */
+  inline long CellCount(const Rect2<int>& region) const {
+    return long(CellOf(region.x + region.w) - CellOf(region.x) + 1) *
+        (CellOf(region.y + region.h) - CellOf(region.y) + 1);
+  }
+
+  inline void Clear() { cells_.clear(); }
+
+private:
+
+  typedef std::vector<T> Cell;
+
+  int cell_size_;
+  std::unordered_map<std::uint64_t, Cell> cells_;
+
+  inline int CellOf(int coord) const {
+    // Round towards negative infinity, so negative coordinates work
+    return coord >= 0 ?
+          coord / cell_size_ : -((-coord + cell_size_ - 1) / cell_size_);
+  }
+
+  inline static std::uint64_t CellKey(int cx, int cy) {
+    return (std::uint64_t(std::uint32_t(cx)) << 32) | std::uint32_t(cy);
+  }
+
+  template <typename Action>
+  void ForEachCell(const Rect2<int>& region, Action action) {
+    int cx0 = CellOf(region.x), cx1 = CellOf(region.x + region.w);
+    int cy0 = CellOf(region.y), cy1 = CellOf(region.y + region.h);
+    for (int cx = cx0; cx <= cx1; cx++) {
+      for (int cy = cy0; cy <= cy1; cy++)
+        action(cells_[CellKey(cx, cy)]);
+    }
+  }
+};
+
+}} // namespace grog::ui
+
+#endif // GROG_UI_SPATIAL_H
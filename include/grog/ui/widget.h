@@ -19,6 +19,8 @@
 #ifndef GROG_UI_WIDGET_H
 #define GROG_UI_WIDGET_H
 
+#include <chrono>
+
 #include "grog/ui/app.h"
 #include "grog/ui/draw.h"
 #include "grog/ui/mouse.h"
@@ -30,10 +32,105 @@ class Widget : public Drawable,
                public virtual MouseResponder {
 public:
 
+  /**
+   * Statistics of the drawing of a widget. They include the drawing of its
+   * descendants, as long as they are rendered through Render().
+   */
+  struct DrawStats {
+    unsigned long draws;
+    unsigned long primitives;
+    std::chrono::nanoseconds draw_time;
+
+    /**
+     * The times the widget was drawn in the last complete second.
+     */
+    unsigned long draws_per_second;
+
+    inline DrawStats()
+      : draws(0), primitives(0), draw_time(0), draws_per_second(0) {}
+  };
+
   Widget(const Ptr<ApplicationContext>& app_ctx = nullptr);
 
+  virtual ~Widget();
+
+  /**
+   * Draw the widget, accounting the draw in its stats when enabled.
+   * Containers must draw their children with this function rather than
+   * Draw(), so the cost of each subtree can be told apart.
+   */
+  void Render(const Rect2<int>& screen_region) const;
+
+  inline const DrawStats& draw_stats() const { return draw_stats_.stats; }
+
+  inline void ResetDrawStats() { draw_stats_ = DrawStatsState(); }
+
+  /**
+   * Enable or disable draw stats for all widgets. They are disabled by
+   * default, so rendering costs nothing but a flag check.
+   */
+  static inline void set_draw_stats_enabled(bool value) {
+    draw_stats_enabled_ = value;
+  }
+
+  static inline bool draw_stats_enabled() { return draw_stats_enabled_; }
+
+  /**
+   * Obtain the widget this one is a child of, or null if none. It is set
+   * by the container the widget is added to.
+   */
+  inline const Widget* parent() const { return parent_; }
+
+  inline void set_parent(const Widget* parent) { parent_ = parent; }
+
+  /**
+   * Clear the parent of this widget if it is the given one. Containers do
+   * so when the widget is removed or they are destroyed, as the widget may
+   * outlive them.
+   */
+  inline void ClearParent(const Widget* parent) {
+    if (parent_ == parent)
+      parent_ = nullptr;
+  }
+
+  /**
+   * Whether the output of the widget is retained. A retained widget
+   * records what it draws the first time it is rendered, and replays the
+   * recording instead of drawing again until invalidated or rendered on a
+   * different region. The recording is clipped to the region of the
+   * widget.
+   */
+  inline bool retained() const { return bool(retained_output_); }
+
+  void set_retained(bool value);
+
+  /**
+   * Whether the widget is cached as a layer. A widget cached as a layer is
+   * drawn once on a layer of the screen, which is composited instead of
+   * drawing again until invalidated, rendered on a different region or
+   * dropped from the layer cache. It is meant for subtrees that are costly
+   * to draw but rarely change. Widgets are drawn as usual if the screen
+   * doesn't support layers, or while recording.
+   */
+  inline bool cached_as_layer() const { return cached_as_layer_; }
+
+  void set_cached_as_layer(bool value);
+
+  /**
+   * Discard the recorded output and layers of this widget and its
+   * ancestors, so they are drawn again next time. A widget must invalidate
+   * itself whenever something that affects its drawing changes.
+   */
+  void Invalidate() const;
+
   virtual Ptr<ApplicationContext> context() { return app_ctx_; }
 
+  /**
+   * Convenience function to obtain the screen the widget is drawn on. Unlike
+   * context(), it may be used from const functions as Draw().
+   */
+  inline Screen& screen() const { return app_ctx_->screen(); }
+
   inline bool enabled() const { return enabled_; }
 
   inline void set_enabled(bool value) { enabled_ = value; }
@@ -46,12 +143,46 @@ public:
 
   inline void set_visible(bool value) { visible_ = value; }
 
+  /**
+   * Whether the widget paints every pixel of its region with an opaque
+   * color. Layouts may skip drawing the widgets hidden behind an opaque one.
+   */
+  inline virtual bool opaque() const { return false; }
+
 private:
 
+  struct DrawStatsState {
+    DrawStats stats;
+    std::chrono::steady_clock::time_point second_start;
+    unsigned long draws_in_second;
+
+    inline DrawStatsState() : draws_in_second(0) {}
+  };
+
+  struct RetainedOutput {
+    DrawCommandList commands;
+    Rect2<int> region;
+    bool valid;
+
+    inline RetainedOutput() : region(0, 0, 0, 0), valid(false) {}
+  };
+
+  static bool draw_stats_enabled_;
+
   Ptr<ApplicationContext> app_ctx_;
+  const Widget* parent_;
+  Ptr<RetainedOutput> retained_output_;
   bool enabled_;
   bool locked_;
   bool visible_;
+  mutable DrawStatsState draw_stats_;
+  bool cached_as_layer_;
+  mutable bool layer_valid_;
+  mutable Rect2<int> layer_region_;
+
+  void Produce(const Rect2<int>& screen_region) const;
+
+  bool ProduceLayer(const Rect2<int>& screen_region) const;
 };
 
 /**
@@ -63,6 +194,11 @@ public:
   inline WrapperWidget(
       const Ptr<ApplicationContext>& app_ctx) : Widget(app_ctx) {}
 
+  inline virtual ~WrapperWidget() {
+    if (child_)
+      child_->ClearParent(this);
+  }
+
   virtual void Draw(const Rect2<int>& screen_region) const;
 
   /**
@@ -70,8 +206,12 @@ public:
    */
   template <typename L>
   inline L& set_child(const Ptr<L>& child) {
+    if (child_)
+      child_->ClearParent(this);
     child_ = child;
+    child_->set_parent(this);
     set_delegate(child_);
+    Invalidate();
     return *child;
   }
 
@@ -0,0 +1,100 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UTIL_CONCURRENT_H
+#define GROG_UTIL_CONCURRENT_H
+
+#include <atomic>
+#include <utility>
+
+#include "grog/util/lang.h"
+
+namespace grog { namespace util {
+
+/**
+ * A lock-free, unbounded, multiple-producer single-consumer queue. Any
+ * number of threads may push elements concurrently, but only one thread at
+ * a time may pop them. Pushing never blocks: it takes a single atomic
+ * exchange no matter how many producers are contending.
+ *
+ * A pop may transiently find the queue empty while a producer is half-way
+ * through a push; the element becomes visible as soon as the push
+ * completes. The element type must be default-constructible.
+ */
+template <typename T>
+class MPSCQueue : NonCopyable {
+public:
+
+  inline MPSCQueue() : head_(new Node()), tail_(head_.load()) {}
+
+  inline ~MPSCQueue() {
+    T value;
+    while (Pop(value)) {}
+    delete tail_;
+  }
+
+  /**
+   * Push a new element at the end of the queue. Safe to call from any thread.
+   */
+  inline void Push(const T& value) {
+    Node* node = new Node(value);
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /**
+   * Pop the element at the front of the queue into value, returning false
+   * if the queue is empty. Must only be called from the consumer thread.
+   */
+  inline bool Pop(T& value) {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (!next)
+      return false;
+    value = std::move(next->value);
+    tail_ = next;
+    delete tail;
+    return true;
+  }
+
+  /**
+   * Check whether the queue is empty. Must only be called from the consumer
+   * thread.
+   */
+  inline bool empty() const {
+    return !tail_->next.load(std::memory_order_acquire);
+  }
+
+private:
+
+  struct Node {
+    std::atomic<Node*> next;
+    T value;
+
+    inline Node() : next(nullptr) {}
+    inline Node(const T& value) : next(nullptr), value(value) {}
+  };
+
+  // Producers append after head, the consumer pops after tail
+  std::atomic<Node*> head_;
+  Node* tail_;
+};
+
+}} // namespace grog::util
+
+#endif // GROG_UTIL_CONCURRENT_H
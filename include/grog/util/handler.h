@@ -0,0 +1,187 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UTIL_HANDLER_H
+#define GROG_UTIL_HANDLER_H
+
+#include <utility>
+#include <vector>
+
+#include "grog/util/lang.h"
+#include "grog/util/platform.h"
+
+namespace grog { namespace util {
+
+/**
+ * A token that identifies a handler registered in a handler table. Tokens
+ * are never reused, so a stale token doesn't match any handler added after
+ * the one it identified was removed. A default-constructed token matches no
+ * handler at all.
+ */
+struct HandlerToken {
+  UInt32 slot;
+  UInt32 generation;
+
+  inline HandlerToken() : slot(0), generation(0) {}
+
+  inline HandlerToken(UInt32 slot, UInt32 generation)
+    : slot(slot), generation(generation) {}
+
+  inline bool valid() const { return generation != 0; }
+
+  inline bool operator == (const HandlerToken& other) const {
+    return slot == other.slot && generation == other.generation;
+  }
+};
+
+/**
+ * A table of event handlers. Handlers are stored in a contiguous array of
+ * slots, and the slots of removed handlers are reused by later additions,
+ * so both adding and removing a handler take constant time and dispatching
+ * never chases list nodes.
+ *
+ * Handlers may add and remove handlers, themselves included, while an event
+ * is being dispatched. Handlers removed during a dispatch are not invoked
+ * from then on, and handlers added during a dispatch are not invoked until
+ * the next one.
+ */
+template <typename Handler>
+class HandlerTable : NonCopyable {
+public:
+
+  inline HandlerTable() : size_(0), dispatching_(0) {}
+
+  /**
+   * Add a new handler, returning the token to remove it.
+   */
+  HandlerToken Add(const Handler& handler) {
+    UInt32 index;
+    if (!free_.empty()) {
+      index = free_.back();
+      free_.pop_back();
+    } else if (!dispatching_) {
+      index = UInt32(slots_.size());
+      slots_.push_back(Slot());
+    } else {
+      // Growing the array would move the handler being invoked
+      index = UInt32(slots_.size() + added_.size());
+      added_.push_back(Slot());
+    }
+    auto& slot = index < slots_.size() ?
+        slots_[index] : added_[index - slots_.size()];
+    slot.handler = handler;
+    slot.live = true;
+    slot.pending = dispatching_ > 0;
+    if (slot.pending)
+      pending_.push_back(index);
+    size_++;
+    return HandlerToken(index, slot.generation);
+  }
+
+  /**
+   * Remove the handler identified by given token. Return false if there is
+   * no such handler, e.g., because it was already removed.
+   */
+  bool Remove(const HandlerToken& token) {
+    auto slot = Find(token);
+    if (!slot || !slot->live)
+      return false;
+    slot->live = false;
+    if (!++slot->generation)
+      slot->generation = 1;
+    size_--;
+    if (dispatching_) {
+      // The handler may be the one being invoked, destroy it afterwards
+      removed_.push_back(token.slot);
+    } else {
+      Release(token.slot);
+    }
+    return true;
+  }
+
+  /**
+   * Invoke all the handlers with given arguments.
+   */
+  template <typename... Args>
+  void Dispatch(Args&&... args) {
+    dispatching_++;
+    auto count = slots_.size();
+    for (std::size_t i = 0; i < count; i++) {
+      auto& slot = slots_[i];
+      if (slot.live && !slot.pending)
+        slot.handler(args...);
+    }
+    if (!--dispatching_ && (!pending_.empty() || !removed_.empty()))
+      Commit();
+  }
+
+  inline std::size_t size() const { return size_; }
+
+  inline bool empty() const { return !size_; }
+
+private:
+
+  struct Slot {
+    Handler handler;
+    UInt32 generation;
+    bool live;
+    bool pending;
+
+    inline Slot() : generation(1), live(false), pending(false) {}
+  };
+
+  std::vector<Slot> slots_;
+  std::vector<Slot> added_;
+  std::vector<UInt32> free_;
+  std::vector<UInt32> pending_;
+  std::vector<UInt32> removed_;
+  std::size_t size_;
+  int dispatching_;
+
+  inline Slot* Find(const HandlerToken& token) {
+    Slot* slot = nullptr;
+    if (token.slot < slots_.size())
+      slot = &slots_[token.slot];
+    else if (token.slot - slots_.size() < added_.size())
+      slot = &added_[token.slot - slots_.size()];
+    return slot && slot->generation == token.generation ? slot : nullptr;
+  }
+
+  inline void Release(UInt32 index) {
+    auto& slot = index < slots_.size() ?
+        slots_[index] : added_[index - slots_.size()];
+    slot.handler = Handler();
+    free_.push_back(index);
+  }
+
+  void Commit() {
+    for (auto& slot : added_)
+      slots_.push_back(std::move(slot));
+    added_.clear();
+    for (auto index : pending_)
+      slots_[index].pending = false;
+    pending_.clear();
+    for (auto index : removed_)
+      Release(index);
+    removed_.clear();
+  }
+};
+
+}} // namespace grog::util
+
+#endif // GROG_UTIL_HANDLER_H
@@ -20,8 +20,14 @@
 #define GROG_UTIL_LANG_H
 
 #include <functional>
-#include <list>
+#include <map>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "grog/util/error.h"
 
@@ -78,6 +84,25 @@ private:
   inline NonCopyable& operator = (const NonCopyable& obj);
 };
 
+/**
+ * A channel to notify messages to subscribers. Subscribers listen either to
+ * any message, to messages of a given type, or to messages of a given type
+ * from senders of a given type. A subscriber for a type receives messages
+ * (or senders) of that type or of any type derived from it.
+ *
+ * Subscribers are indexed by the dynamic types of the sender and the
+ * message, so a notification only reaches the subscribers interested in
+ * it. The index is built lazily the first time each pair of types is
+ * notified, and rebuilt after new subscriptions.
+ *
+ * Notifications may be either delivered right away with Notify(), or posted
+ * with Post() to be delivered later, all at once, by Flush(). Posted
+ * notifications are coalesced: each sender notifies each message type at
+ * most once per flush, no matter how many times it was posted.
+ *
+ * Typed senders and messages must derive non-virtually from Sender and
+ * Message, respectively.
+ */
 class NotificationChannel {
 public:
 
@@ -105,25 +130,109 @@ public:
     typedef std::function<void(const S& s, const T&)> Type;
   };
 
+  /**
+   * An identifier of a subscription, used to unsubscribe.
+   */
+  typedef unsigned long SubscriptionId;
+
+  /**
+   * A function invoked when a notification is posted and none was pending,
+   * so that a later flush can be arranged.
+   */
+  typedef std::function<void(void)> FlushScheduler;
+
+  inline NotificationChannel() : next_subscription_(1) {}
+
+  /**
+   * Notify given message from given sender to the interested subscribers,
+   * in the order they subscribed. Subscribers may subscribe and unsubscribe
+   * while being notified.
+   */
   template <typename S, typename T>
   inline void Notify(const S& s, const T& t) {
-    for (auto& subscriber : subscribers_)
-      subscriber->Receive(s, t);
+    Dispatch(s, t);
+  }
+
+  /**
+   * Post given message from given sender to be notified on the next flush.
+   * If the sender already posted a message of type T since the last flush,
+   * it is replaced by this one, keeping its place in the queue. The message
+   * is copied as a T, but the sender is not, so it must outlive the flush.
+   */
+  template <typename S, typename T>
+  inline void Post(const S& s, const T& t) {
+    const Sender& sender = s;
+    PostKey key(&sender, typeid(T));
+    auto posted = posted_.find(key);
+    if (posted != posted_.end()) {
+      pending_[posted->second].msg = Ptr<Message>(new T(t));
+      return;
+    }
+    posted_.insert(std::make_pair(key, pending_.size()));
+    pending_.push_back(PendingNotification(&sender, new T(t)));
+    if (pending_.size() == 1 && flush_scheduler_)
+      flush_scheduler_();
+  }
+
+  /**
+   * Deliver the posted notifications, in the order they were first posted.
+   * Notifications posted while flushing are delivered on the next flush.
+   */
+  inline void Flush() {
+    std::vector<PendingNotification> pending;
+    pending.swap(pending_);
+    posted_.clear();
+    for (auto& notification : pending)
+      Dispatch(*notification.sender, *notification.msg);
+  }
+
+  /**
+   * Obtain the number of notifications posted but not yet delivered.
+   */
+  inline std::size_t pending() const { return pending_.size(); }
+
+  inline void set_flush_scheduler(const FlushScheduler& scheduler) {
+    flush_scheduler_ = scheduler;
   }
 
-  inline void Listen(const Callback::Type& callback) {
-    subscribers_.push_back(new UntypedSubscriber(callback));
+  inline SubscriptionId Listen(const Callback::Type& callback) {
+    return Subscribe(new UntypedSubscriber(callback));
   }
 
   template <typename T>
-  inline void Listen(const typename CallbackByMessage<T>::Type& callback) {
-    subscribers_.push_back(new TypedMessageSubscriber<T>(callback));
+  inline SubscriptionId Listen(
+      const typename CallbackByMessage<T>::Type& callback) {
+    return Subscribe(new TypedMessageSubscriber<T>(callback));
   }
 
   template <typename S, typename T>
-  inline void Listen(
+  inline SubscriptionId Listen(
       const typename CallbackBySenderAndMessage<S, T>::Type& callback) {
-    subscribers_.push_back(new TypedSenderMessageSubscriber<S, T>(callback));
+    return Subscribe(new TypedSenderMessageSubscriber<S, T>(callback));
+  }
+
+  /**
+   * Cancel the given subscription. Return false if there is no such
+   * subscription, e.g., because it was already cancelled.
+   */
+  inline bool Unsubscribe(SubscriptionId id) {
+    auto subscriber = subscribers_.find(id);
+    if (subscriber == subscribers_.end())
+      return false;
+
+    // Lists being dispatched must not change, so filter them into new ones
+    auto removed = subscriber->second;
+    removed->active = false;
+    subscribers_.erase(subscriber);
+    for (auto& entry : dispatch_table_) {
+      Ptr<SubscriberList> list(new SubscriberList());
+      for (auto& s : *entry.second) {
+        if (s != removed)
+          list->push_back(s);
+      }
+      entry.second = list;
+    }
+    return true;
   }
 
 private:
@@ -131,10 +240,23 @@ private:
   class Subscriber {
   public:
 
+    bool active;
+
+    inline Subscriber() : active(true) {}
+
     inline virtual ~Subscriber() {}
 
+    /**
+     * Check whether this subscriber is interested in messages like the
+     * given one from senders like the given one. The answer depends only
+     * on their dynamic types.
+     */
+    virtual bool Accepts(const Sender& sender, const Message& msg) const = 0;
+
+    /**
+     * Receive a message, which is known to be accepted.
+     */
     virtual void Receive(const Sender& sender, const Message& msg) = 0;
-    virtual void Receive(const Message& msg) = 0;
   };
 
   class UntypedSubscriber : public Subscriber {
@@ -143,11 +265,12 @@ private:
     inline UntypedSubscriber(
         const Callback::Type& callback) : callback_(callback) {}
 
-    inline virtual void Receive(const Sender& sender, const Message& msg) {
-      callback_();
+    inline virtual bool Accepts(
+        const Sender& sender, const Message& msg) const {
+      return true;
     }
 
-    inline virtual void Receive(const Message& msg) {
+    inline virtual void Receive(const Sender& sender, const Message& msg) {
       callback_();
     }
 
@@ -163,14 +286,13 @@ private:
         const typename CallbackByMessage<T>::Type& callback)
       : callback_(callback) {}
 
-    inline virtual void Receive(const Sender& sender, const Message& msg) {
-      Receive(msg);
+    inline virtual bool Accepts(
+        const Sender& sender, const Message& msg) const {
+      return dynamic_cast<const T*>(&msg);
     }
 
-    inline virtual void Receive(const Message& msg) {
-      T* typed_msg = dynamic_cast<T*>(&msg);
-      if (typed_msg)
-        callback_(*typed_msg);
+    inline virtual void Receive(const Sender& sender, const Message& msg) {
+      callback_(static_cast<const T&>(msg));
     }
 
   private:
@@ -178,53 +300,177 @@ private:
   };
 
   template <typename S, typename T>
-  class TypedSenderMessageSubscriber : Subscriber {
+  class TypedSenderMessageSubscriber : public Subscriber {
   public:
 
     inline TypedSenderMessageSubscriber(
         const typename CallbackBySenderAndMessage<S, T>::Type& callback)
       : callback_(callback) {}
 
-    inline virtual void Receive(const Sender& sender, const Message& msg) {
-      S* typed_sender = dynamic_cast<S*>(&sender);
-      T* typed_msg = dynamic_cast<T*>(&msg);
-      if (typed_sender && typed_msg)
-        callback_(*typed_sender, *typed_msg);
+    inline virtual bool Accepts(
+        const Sender& sender, const Message& msg) const {
+      return dynamic_cast<const S*>(&sender) && dynamic_cast<const T*>(&msg);
     }
 
-    inline virtual void Receive(const Message& msg) {
-      T* typed_msg = dynamic_cast<T*>(&msg);
-      if (typed_msg)
-        callback_(*typed_msg);
+    inline virtual void Receive(const Sender& sender, const Message& msg) {
+      callback_(static_cast<const S&>(sender), static_cast<const T&>(msg));
     }
 
   private:
     typename CallbackBySenderAndMessage<S, T>::Type callback_;
   };
 
-  std::list<Ptr<Subscriber> > subscribers_;
+  struct PendingNotification {
+    const Sender* sender;
+    Ptr<Message> msg;
+
+    inline PendingNotification(const Sender* sender, Message* msg)
+      : sender(sender), msg(msg) {}
+  };
+
+  typedef std::vector<Ptr<Subscriber> > SubscriberList;
+  typedef std::pair<std::type_index, std::type_index> TypeKey;
+  typedef std::pair<const Sender*, std::type_index> PostKey;
+
+  struct TypeKeyHash {
+    inline std::size_t operator () (const TypeKey& key) const {
+      return key.first.hash_code() * 31 + key.second.hash_code();
+    }
+  };
+
+  struct PostKeyHash {
+    inline std::size_t operator () (const PostKey& key) const {
+      return std::hash<const Sender*>()(key.first) * 31 +
+          key.second.hash_code();
+    }
+  };
+
+  std::map<SubscriptionId, Ptr<Subscriber> > subscribers_;
+  std::unordered_map<TypeKey, Ptr<SubscriberList>, TypeKeyHash>
+      dispatch_table_;
+  SubscriptionId next_subscription_;
+  std::vector<PendingNotification> pending_;
+  std::unordered_map<PostKey, std::size_t, PostKeyHash> posted_;
+  FlushScheduler flush_scheduler_;
+
+  inline SubscriptionId Subscribe(const Ptr<Subscriber>& subscriber) {
+    auto id = next_subscription_++;
+    subscribers_[id] = subscriber;
+    dispatch_table_.clear();
+    return id;
+  }
+
+  inline void Dispatch(const Sender& sender, const Message& msg) {
+    TypeKey key(typeid(sender), typeid(msg));
+    auto& entry = dispatch_table_[key];
+    if (!entry) {
+      entry = Ptr<SubscriberList>(new SubscriberList());
+      for (auto& subscriber : subscribers_) {
+        if (subscriber.second->Accepts(sender, msg))
+          entry->push_back(subscriber.second);
+      }
+    }
+
+    // Hold the list, in case a subscriber changes the dispatch table
+    auto list = entry;
+    for (auto& subscriber : *list) {
+      if (subscriber->active)
+        subscriber->Receive(sender, msg);
+    }
+  }
 };
 
+/**
+ * An optional value. The value is stored inline, so wrapping an object into
+ * an option doesn't allocate memory. Use Option<T&> for optional references
+ * to objects owned by someone else.
+ */
 template <typename T>
 class Option {
 public:
 
   GROG_DECL_ERROR(NoneError, IllegalStateError);
 
-  static Option Some(const Ptr<T>& obj) { return Option(obj); }
+  static Option Some(const T& obj) { return Option(obj); }
   static Option None() { return Option(); }
 
+  inline Option(const Option& opt) : valid_(false) {
+    if (opt.valid_)
+      Construct(*opt.ptr());
+  }
+
+  inline ~Option() { Destroy(); }
+
+  inline Option& operator = (const Option& opt) {
+    if (this != &opt) {
+      Destroy();
+      if (opt.valid_)
+        Construct(*opt.ptr());
+    }
+    return *this;
+  }
+
   inline operator bool() const { return valid(); }
 
-  inline bool valid() const { return bool(obj_); }
+  inline bool valid() const { return valid_; }
 
   inline const T& value() const throw (NoneError) {
-    if (!obj_)
+    if (!valid_)
       GROG_THROW_ERROR(NoneError());
-    return *obj_;
+    return *ptr();
   }
 
   inline T& value() throw (NoneError) {
+    if (!valid_)
+      GROG_THROW_ERROR(NoneError());
+    return *ptr();
+  }
+
+private:
+
+  typename std::aligned_storage<
+      sizeof(T), std::alignment_of<T>::value>::type storage_;
+  bool valid_;
+
+  inline Option() : valid_(false) {}
+
+  inline explicit Option(const T& obj) : valid_(false) { Construct(obj); }
+
+  inline const T* ptr() const { return reinterpret_cast<const T*>(&storage_); }
+
+  inline T* ptr() { return reinterpret_cast<T*>(&storage_); }
+
+  inline void Construct(const T& obj) {
+    new (&storage_) T(obj);
+    valid_ = true;
+  }
+
+  inline void Destroy() {
+    if (valid_) {
+      ptr()->~T();
+      valid_ = false;
+    }
+  }
+};
+
+/**
+ * An optional reference. The referenced object is not owned by the option,
+ * so it must outlive it.
+ */
+template <typename T>
+class Option<T&> {
+public:
+
+  GROG_DECL_ERROR(NoneError, IllegalStateError);
+
+  static Option Some(T& obj) { return Option(&obj); }
+  static Option None() { return Option(); }
+
+  inline operator bool() const { return valid(); }
+
+  inline bool valid() const { return obj_ != nullptr; }
+
+  inline T& value() const throw (NoneError) {
     if (!obj_)
       GROG_THROW_ERROR(NoneError());
     return *obj_;
@@ -232,9 +478,9 @@ public:
 
 private:
 
-  Ptr<T> obj_;
+  T* obj_;
 
-  inline Option(const Ptr<T>& obj = nullptr) : obj_(obj) {}
+  inline Option(T* obj = nullptr) : obj_(obj) {}
 };
 
 /**
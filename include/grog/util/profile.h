@@ -0,0 +1,206 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UTIL_PROFILE_H
+#define GROG_UTIL_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "grog/util/lang.h"
+
+/*
+ * Scoped timers are compiled in only when GROG_PROFILE is defined to a
+ * non-zero value, so they cost nothing otherwise. The profiler itself is
+ * always available.
+ */
+#if defined(GROG_PROFILE) && GROG_PROFILE
+  #define GROG_PROFILE_CONCAT_(a, b) a ## b
+  #define GROG_PROFILE_CONCAT(a, b) GROG_PROFILE_CONCAT_(a, b)
+  #define GROG_PROFILE_SCOPE(name) \
+      ::grog::util::ProfileScope GROG_PROFILE_CONCAT( \
+          grog_profile_scope_, __LINE__)(name)
+#else
+  #define GROG_PROFILE_SCOPE(name)
+#endif
+
+namespace grog { namespace util {
+
+/**
+ * A profiler that records timed scopes into per-thread ring buffers. Each
+ * thread only writes to its own buffer, so recording takes no locks. Once
+ * a buffer is full, the oldest events are overwritten.
+ *
+ * The recorded events may be exported in the JSON format of Chrome's
+ * trace_event, to be opened in chrome://tracing. Exporting while other
+ * threads are recording may show some of their events torn.
+ */
+class Profiler : NonCopyable {
+public:
+
+  typedef std::chrono::steady_clock Clock;
+
+  /**
+   * A timed scope. The name must be a string literal, or otherwise outlive
+   * the profiler.
+   */
+  struct Event {
+    const char* name;
+    Clock::time_point start;
+    Clock::duration duration;
+  };
+
+  static const std::size_t kDefaultBufferCapacity = 1 << 16;
+
+  static inline Profiler& instance() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  inline explicit Profiler(
+      std::size_t buffer_capacity = kDefaultBufferCapacity)
+    : id_(NextProfilerId()), epoch_(Clock::now()),
+      buffer_capacity_(buffer_capacity) {}
+
+  /**
+   * Record an event on the buffer of the calling thread.
+   */
+  inline void Record(const char* name, const Clock::time_point& start,
+                     const Clock::time_point& end) {
+    auto& buffer = ThreadBufferOf(*this);
+    auto count = buffer.count.load(std::memory_order_relaxed);
+    auto& event = buffer.events[count % buffer.events.size()];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    buffer.count.store(count + 1, std::memory_order_release);
+  }
+
+  /**
+   * Discard all the recorded events.
+   */
+  inline void Clear() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (auto& buffer : buffers_)
+      buffer->count.store(0, std::memory_order_release);
+  }
+
+  /**
+   * Export the recorded events in Chrome trace_event JSON format.
+   */
+  inline void ExportChromeTrace(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (auto& buffer : buffers_) {
+      auto count = buffer->count.load(std::memory_order_acquire);
+      auto capacity = buffer->events.size();
+      auto begin = count > capacity ? count - capacity : 0;
+      for (auto i = begin; i < count; i++) {
+        auto& event = buffer->events[i % capacity];
+        out << (first ? "\n" : ",\n") <<
+            "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1," <<
+            "\"tid\":" << buffer->thread_id <<
+            ",\"ts\":" << Micros(event.start - epoch_) <<
+            ",\"dur\":" << Micros(event.duration) << "}";
+        first = false;
+      }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  }
+
+private:
+
+  struct ThreadBuffer {
+    std::vector<Event> events;
+    std::atomic<unsigned long> count;
+    unsigned int thread_id;
+
+    inline ThreadBuffer(std::size_t capacity, unsigned int thread_id)
+      : events(capacity), count(0), thread_id(thread_id) {}
+  };
+
+  unsigned long id_;
+  Clock::time_point epoch_;
+  std::size_t buffer_capacity_;
+  std::mutex buffers_mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer> > buffers_;
+
+  static inline double Micros(const Clock::duration& duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+
+  /*
+   * Obtain the buffer of the calling thread for given profiler, creating it
+   * on first use. Buffers are owned by the profiler, so they outlive their
+   * threads and can be exported afterwards.
+   */
+  static inline ThreadBuffer& ThreadBufferOf(Profiler& profiler) {
+    // Profilers are told apart by id, since addresses may be reused
+    typedef std::pair<unsigned long, ThreadBuffer*> CachedBuffer;
+    static thread_local std::vector<CachedBuffer> cached_buffers;
+    for (auto& cached : cached_buffers) {
+      if (cached.first == profiler.id_)
+        return *cached.second;
+    }
+
+    std::lock_guard<std::mutex> lock(profiler.buffers_mutex_);
+    profiler.buffers_.push_back(std::make_shared<ThreadBuffer>(
+        profiler.buffer_capacity_, unsigned(profiler.buffers_.size() + 1)));
+    cached_buffers.push_back(
+        CachedBuffer(profiler.id_, profiler.buffers_.back().get()));
+    return *cached_buffers.back().second;
+  }
+
+  static inline unsigned long NextProfilerId() {
+    static std::atomic<unsigned long> next_id(1);
+    return next_id++;
+  }
+};
+
+/**
+ * A timer that records the scope it lives in as an event of the profiler.
+ * Use GROG_PROFILE_SCOPE() rather than this class, so the timer can be
+ * compiled out.
+ */
+class ProfileScope : NonCopyable {
+public:
+
+  inline explicit ProfileScope(
+      const char* name, Profiler& profiler = Profiler::instance())
+    : profiler_(profiler), name_(name), start_(Profiler::Clock::now()) {}
+
+  inline ~ProfileScope() {
+    profiler_.Record(name_, start_, Profiler::Clock::now());
+  }
+
+private:
+
+  Profiler& profiler_;
+  const char* name_;
+  Profiler::Clock::time_point start_;
+};
+
+}} // namespace grog::util
+
+#endif // GROG_UTIL_PROFILE_H
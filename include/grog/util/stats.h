@@ -0,0 +1,117 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UTIL_STATS_H
+#define GROG_UTIL_STATS_H
+
+#include <chrono>
+#include <vector>
+
+namespace grog { namespace util {
+
+/**
+ * A histogram of latencies with microsecond resolution. Latencies are
+ * counted in buckets whose width grows with the latency, so the histogram
+ * takes constant memory while any percentile is estimated within 1/16 of
+ * its actual value.
+ */
+class LatencyHistogram {
+public:
+
+  typedef std::chrono::microseconds Duration;
+
+  inline LatencyHistogram()
+    : buckets_(kBucketCount, 0), count_(0), max_(0) {}
+
+  inline void Record(const Duration& latency) {
+    auto value = latency.count() > 0 ?
+        static_cast<unsigned long long>(latency.count()) : 0ULL;
+    buckets_[BucketOf(value)]++;
+    count_++;
+    if (value > max_)
+      max_ = value;
+  }
+
+  /**
+   * Estimate the latency below which the given percentage of the recorded
+   * latencies fall, or zero if none were recorded.
+   */
+  inline Duration Percentile(double percentage) const {
+    if (!count_)
+      return Duration(0);
+    auto rank = static_cast<unsigned long>(percentage / 100.0 * count_);
+    if (rank >= count_)
+      rank = count_ - 1;
+    unsigned long seen = 0;
+    for (unsigned int i = 0; i < kBucketCount; i++) {
+      seen += buckets_[i];
+      if (seen > rank) {
+        auto upper = UpperBoundOf(i);
+        return Duration(upper < max_ ? upper : max_);
+      }
+    }
+    return Duration(max_);
+  }
+
+  inline Duration max() const { return Duration(max_); }
+
+  inline unsigned long count() const { return count_; }
+
+  inline void Clear() {
+    buckets_.assign(kBucketCount, 0);
+    count_ = 0;
+    max_ = 0;
+  }
+
+private:
+
+  /* Values under kSubBuckets have a bucket each; above, every power of two
+   * range is split into kSubBuckets buckets. */
+  static const unsigned int kSubBucketBits = 4;
+  static const unsigned int kSubBuckets = 1 << kSubBucketBits;
+  static const unsigned int kBucketCount =
+      kSubBuckets + (64 - kSubBucketBits) * kSubBuckets;
+
+  std::vector<unsigned long> buckets_;
+  unsigned long count_;
+  unsigned long long max_;
+
+  static inline unsigned int BucketOf(unsigned long long value) {
+    if (value < kSubBuckets)
+      return static_cast<unsigned int>(value);
+    unsigned int log2 = 0;
+    while (value >> (log2 + 1))
+      log2++;
+    auto shift = log2 - kSubBucketBits;
+    auto sub = static_cast<unsigned int>(value >> shift) & (kSubBuckets - 1);
+    return kSubBuckets + shift * kSubBuckets + sub;
+  }
+
+  static inline unsigned long long UpperBoundOf(unsigned int bucket) {
+    if (bucket < kSubBuckets)
+      return bucket;
+    auto shift = (bucket - kSubBuckets) / kSubBuckets;
+    auto sub = (bucket - kSubBuckets) % kSubBuckets;
+    return ((static_cast<unsigned long long>(kSubBuckets + sub + 1)) <<
+        shift) - 1;
+  }
+};
+
+}} // namespace grog::util
+
+#endif // GROG_UTIL_STATS_H
@@ -0,0 +1,223 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_UTIL_TIMER_H
+#define GROG_UTIL_TIMER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "grog/util/lang.h"
+
+namespace grog { namespace util {
+
+/**
+ * A hierarchical timer wheel. Timers are kept in slots of several wheels of
+ * increasing granularity: the first wheel has one slot per tick, and each
+ * of the next ones has slots spanning a whole turn of the previous wheel.
+ * As time advances, the slots of coarser wheels are cascaded down to finer
+ * ones, so scheduling, cancelling and expiring a timer take constant time
+ * regardless of the number of timers.
+ *
+ * The wheel doesn't measure time by itself. Its users decide what a tick
+ * means, and tell the wheel how time passes by calling Advance().
+ */
+template <typename T>
+class TimerWheel : NonCopyable {
+public:
+
+  typedef std::uint64_t Ticks;
+  typedef std::uint64_t TimerId;
+
+  inline TimerWheel(Ticks now = 0) : next_tick_(now), next_id_(0) {
+    for (auto& count : entry_counts_)
+      count = 0;
+  }
+
+  inline bool empty() const { return timers_.empty(); }
+
+  inline std::size_t size() const { return timers_.size(); }
+
+  /**
+   * Schedule a new timer to expire on given tick. Timers scheduled for a
+   * past tick expire on the next call to Advance().
+   */
+  TimerId Schedule(Ticks deadline, const T& value) {
+    auto id = next_id_++;
+    timers_[id] = value;
+    Insert(Entry(id, deadline < next_tick_ ? next_tick_ : deadline));
+    return id;
+  }
+
+  /**
+   * Cancel the given timer. Nothing happens if it already expired.
+   */
+  inline void Cancel(TimerId id) { timers_.erase(id); }
+
+  /**
+   * Advance the wheel up to given tick, inclusive, appending the values of
+   * all the timers expired meanwhile to given vector.
+   */
+  void Advance(Ticks now, std::vector<T>& expired) {
+    while (next_tick_ <= now) {
+      if (timers_.empty()) {
+        // Nothing may expire, skip all the remaining ticks at once
+        Reset(now + 1);
+        return;
+      }
+
+      // Once the finer wheel completes a turn, bring the next slot of the
+      // coarser one down
+      for (unsigned level = 1; level < kLevels; level++) {
+        if (SlotIndex(next_tick_, level - 1) != 0)
+          break;
+        Cascade(level, SlotIndex(next_tick_, level));
+      }
+
+      /*
+       * While the finer wheels are empty, nothing happens until the next
+       * cascade of the first non-empty one, so skip the ticks in between.
+       */
+      unsigned level = 0;
+      while (level < kLevels - 1 && !entry_counts_[level])
+        level++;
+      if (level > 0) {
+        auto turn = Ticks(1) << (level * kSlotBits);
+        auto next_cascade = (next_tick_ | (turn - 1)) + 1;
+        next_tick_ = next_cascade <= now ? next_cascade : now + 1;
+        continue;
+      }
+
+      Slot slot;
+      slot.swap(wheels_[0][SlotIndex(next_tick_, 0)]);
+      entry_counts_[0] -= slot.size();
+      for (auto& entry : slot) {
+        auto timer = timers_.find(entry.id);
+        if (timer != timers_.end()) {
+          expired.push_back(timer->second);
+          timers_.erase(timer);
+        }
+      }
+      next_tick_++;
+    }
+  }
+
+  /**
+   * Obtain the earliest tick a timer may expire on, or none if there are
+   * no timers. The result might be earlier than the actual deadline, but
+   * never later.
+   */
+  Option<Ticks> NextDeadline() const {
+    if (timers_.empty())
+      return Option<Ticks>::None();
+
+    bool found = false;
+    Ticks deadline = 0;
+    for (unsigned level = 0; level < kLevels; level++) {
+      /*
+       * Visit slots in time order. The current slot of a coarser wheel is
+       * cascaded once the finer wheels complete their turn, so unless that
+       * is about to happen, anything there belongs to its next turn.
+       */
+      auto turn = (Ticks(1) << (level * kSlotBits)) - 1;
+      auto first = SlotIndex(next_tick_, level) + ((next_tick_ & turn) ? 1 : 0);
+      for (unsigned i = 0; i < kSlots; i++) {
+        auto& slot = wheels_[level][(first + i) & kSlotMask];
+        if (slot.empty())
+          continue;
+        for (auto& entry : slot) {
+          if (!found || entry.deadline < deadline) {
+            deadline = entry.deadline;
+            found = true;
+          }
+        }
+        break;
+      }
+    }
+    return Option<Ticks>::Some(deadline);
+  }
+
+private:
+
+  static const unsigned kLevels = 4;
+  static const unsigned kSlotBits = 6;
+  static const unsigned kSlots = 1 << kSlotBits;
+  static const unsigned kSlotMask = kSlots - 1;
+
+  struct Entry {
+    TimerId id;
+    Ticks deadline;
+
+    inline Entry(TimerId id, Ticks deadline) : id(id), deadline(deadline) {}
+  };
+
+  typedef std::vector<Entry> Slot;
+
+  Slot wheels_[kLevels][kSlots];
+  std::size_t entry_counts_[kLevels];
+  std::unordered_map<TimerId, T> timers_;
+  Ticks next_tick_;
+  TimerId next_id_;
+
+  inline static unsigned SlotIndex(Ticks tick, unsigned level) {
+    return unsigned(tick >> (level * kSlotBits)) & kSlotMask;
+  }
+
+  void Insert(const Entry& entry) {
+    auto delta = entry.deadline - next_tick_;
+    for (unsigned level = 0; level < kLevels - 1; level++) {
+      if (delta < (Ticks(1) << ((level + 1) * kSlotBits))) {
+        wheels_[level][SlotIndex(entry.deadline, level)].push_back(entry);
+        entry_counts_[level]++;
+        return;
+      }
+    }
+
+    // Deadlines beyond the range of the wheel wait in the last slot they
+    // can reach, and are placed again when cascaded
+    const Ticks max_delta = (Ticks(1) << (kLevels * kSlotBits)) - 1;
+    auto deadline = delta > max_delta ? next_tick_ + max_delta : entry.deadline;
+    wheels_[kLevels - 1][SlotIndex(deadline, kLevels - 1)].push_back(entry);
+    entry_counts_[kLevels - 1]++;
+  }
+
+  void Cascade(unsigned level, unsigned index) {
+    Slot slot;
+    slot.swap(wheels_[level][index]);
+    entry_counts_[level] -= slot.size();
+    for (auto& entry : slot) {
+      if (timers_.count(entry.id))
+        Insert(entry);
+    }
+  }
+
+  void Reset(Ticks now) {
+    for (auto& wheel : wheels_) {
+      for (auto& slot : wheel)
+        slot.clear();
+    }
+    for (auto& count : entry_counts_)
+      count = 0;
+    next_tick_ = now;
+  }
+};
+
+}} // namespace grog::util
+
+#endif // GROG_UTIL_TIMER_H
@@ -0,0 +1,90 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "grog/ui/app-headless.h"
+
+#include "grog/ui/draw-soft.h"
+#include "grog/util/profile.h"
+
+namespace grog { namespace ui {
+
+HeadlessApplicationLoop::HeadlessApplicationLoop() : running_(false) {}
+
+void HeadlessApplicationLoop::AddWorkUnit(const WorkUnit& wu) {
+  work_units_.Push(wu);
+  std::lock_guard<std::mutex> lock(wakeup_mutex_);
+  wakeup_.notify_one();
+}
+
+void HeadlessApplicationLoop::Run() {
+  running_ = true;
+  while (running_) {
+    RunExpiredTimers();
+    ProcessWorkUnits();
+    WaitForWork();
+  }
+}
+
+void HeadlessApplicationLoop::Stop() {
+  running_ = false;
+  std::lock_guard<std::mutex> lock(wakeup_mutex_);
+  wakeup_.notify_one();
+}
+
+void HeadlessApplicationLoop::WaitForWork() {
+  auto ready = [this]() {
+    return !running_ || !repeating_.empty() || !work_units_.empty();
+  };
+  std::unique_lock<std::mutex> lock(wakeup_mutex_);
+  auto deadline = NextTimerDeadline();
+  if (deadline)
+    wakeup_.wait_until(lock, deadline.value(), ready);
+  else
+    wakeup_.wait(lock, ready);
+}
+
+void HeadlessApplicationLoop::ProcessWorkUnits() {
+  GROG_PROFILE_SCOPE("HeadlessApplicationLoop::ProcessWorkUnits");
+  std::vector<WorkUnit> batch;
+  batch.swap(repeating_);
+  WorkUnit wu;
+  while (work_units_.Pop(wu))
+    batch.push_back(wu);
+
+  // Repeating units run again in the next batch, not in this one
+  for (auto& wu : batch) {
+    if (wu())
+      repeating_.push_back(wu);
+  }
+}
+
+Ptr<Screen> SoftwareApplicationContextFactory::CreateScreen(
+    const Application::Properties& props) {
+  return new SoftwareScreen(Vector2<int>(
+      Application::ParseProperty<unsigned>(
+          props.at(Application::kPropNameScreenWidth)),
+      Application::ParseProperty<unsigned>(
+          props.at(Application::kPropNameScreenHeight))));
+}
+
+Ptr<ApplicationLoop> SoftwareApplicationContextFactory::CreateLoop(
+    const Application::Properties &props) {
+  return new HeadlessApplicationLoop();
+}
+
+}} // namespace grog::ui
@@ -17,6 +17,7 @@
  */
 
 #include <iostream>
+#include <vector>
 
 #include "grog/util/platform.h" // required for platform-dependent includes
 
@@ -29,20 +30,18 @@
 #include "grog/ui/app-sdl.h"
 #include "grog/ui/draw-gl.h"
 #include "grog/ui/draw-sdl.h"
+#include "grog/util/profile.h"
 
 namespace grog { namespace ui {
 
 namespace {
 
-enum SDLCustomEvent {
-  kRequestRedisplayEvent,
-  kWorkUnitPending,
-};
-
-MouseMotionEvent ToEvent(const SDL_MouseMotionEvent& ev) {
+MouseMotionEvent ToEvent(const SDL_MouseMotionEvent& ev,
+                         const EventTime& time) {
   return MouseMotionEvent(
         Vector2<int>(ev.x, ev.y),
-        Vector2<int>(ev.xrel, ev.yrel));
+        Vector2<int>(ev.xrel, ev.yrel),
+        time);
 }
 
 MouseButton ToMouseButton(Uint8 btn) {
@@ -64,56 +63,62 @@ MouseButtonState ToMouseButtonState(Uint8 state) {
   }
 }
 
-MouseButtonEvent ToEvent(const SDL_MouseButtonEvent& ev) {
+MouseButtonEvent ToEvent(const SDL_MouseButtonEvent& ev,
+                         unsigned int clicks,
+                         const EventTime& time) {
   return MouseButtonEvent(
         ToMouseButton(ev.button),
         ToMouseButtonState(ev.state),
-        Vector2<int>(ev.x, ev.y));
+        Vector2<int>(ev.x, ev.y),
+        clicks,
+        time);
 }
 
-} // anonymous namespace
+bool IsWakeUp(const SDL_Event& ev) {
+  return ev.type == SDL_USEREVENT &&
+      ev.user.code == SDLApplicationLoop::kWorkUnitPending;
+}
 
-SDLApplicationLoop::~SDLApplicationLoop()
-{
-  if (consolidation_pool_)
-    delete consolidation_pool_;
+bool IsWheel(const SDL_Event& ev, Uint8 type) {
+  return ev.type == type && (ev.button.button == SDL_BUTTON_WHEELUP ||
+                             ev.button.button == SDL_BUTTON_WHEELDOWN);
 }
 
-Ptr<ApplicationLoop> SDLApplicationLoop::instance() {
-  static Ptr<ApplicationLoop> instance(new SDLApplicationLoop());
+} // anonymous namespace
+
+Ptr<SDLApplicationLoop> SDLApplicationLoop::instance() {
+  static Ptr<SDLApplicationLoop> instance(new SDLApplicationLoop());
   return instance;
 }
 
 void SDLApplicationLoop::AddWorkUnit(const WorkUnit& wu) {
-  work_units_.push(wu);
-  SDL_Event event;
-  event.type = SDL_USEREVENT;
-  event.user.code = kWorkUnitPending;
-  SDL_PushEvent(&event);
+  work_units_.Push(wu);
+
+  // Only the first work unit of a batch wakes up the loop, which then
+  // processes the whole batch
+  if (!wakeup_pending_.exchange(true)) {
+    SDL_Event event;
+    event.type = SDL_USEREVENT;
+    event.user.code = kWorkUnitPending;
+
+    // The event queue may be full, let the next unit try to wake it up
+    if (SDL_PushEvent(&event) < 0)
+      wakeup_pending_ = false;
+  }
 }
 
 void SDLApplicationLoop::Run() {
   running_ = true;
   while (running_) {
     SDL_Event event;
-    if (SDL_WaitEvent(&event)) {
-      switch (event.type) {
-        case SDL_MOUSEMOTION:
-          ConsolidateMouseMotion(event.motion);
-          HandleMouseMotionEvent(ToEvent(event.motion));
-          break;
-        case SDL_MOUSEBUTTONUP:
-        case SDL_MOUSEBUTTONDOWN:
-          HandleMouseButtonEvent(ToEvent(event.button));
-          break;
-        case SDL_QUIT:
-          Stop();
-          break;
-        case SDL_USEREVENT:
-          OnUserEvent(event.user);
-          break;
-      }
+    if (WaitEvent(event))
+      ProcessInput(event, std::chrono::steady_clock::now());
+    if (running_) {
+      GROG_PROFILE_SCOPE("SDLApplicationLoop::RunExpiredTimers");
+      RunExpiredTimers();
     }
+    if (running_)
+      ProcessWorkUnits();
   }
 }
 
@@ -122,41 +127,169 @@ void SDLApplicationLoop::Stop() {
 }
 
 SDLApplicationLoop::SDLApplicationLoop()
-  : running_(false), consolidation_pool_len_(1024) {
+  : running_(false), wakeup_pending_(false),
+    work_budget_(std::chrono::milliseconds(10)) {
   if (!SDL_WasInit(SDL_INIT_VIDEO)) {
     SDL_Init(SDL_INIT_VIDEO);
   }
-  consolidation_pool_ = new SDL_Event[1024];
-}
-
-void SDLApplicationLoop::ConsolidateMouseMotion(SDL_MouseMotionEvent &ev) {
-  auto nevents = SDL_PeepEvents(
-        consolidation_pool_,
-        consolidation_pool_len_,
-        SDL_GETEVENT,
-        SDL_EVENTMASK(SDL_MOUSEMOTION));
-  for (unsigned int i = 0; i < nevents; i++) {
-    SDL_MouseMotionEvent& con_ev = consolidation_pool_[i].motion;
-    ev.state = con_ev.state;
-    ev.x = con_ev.x;
-    ev.y = con_ev.y;
-    ev.xrel += con_ev.xrel;
-    ev.yrel += con_ev.yrel;
+}
+
+void SDLApplicationLoop::CoalesceInput(InputBatch& batch, InputStats& stats) {
+  auto& events = batch.events;
+  auto& clicks = batch.clicks;
+  clicks.assign(events.size(), 1);
+  stats.raw_events += events.size();
+
+  std::size_t len = 0;
+  bool wakeup_seen = false;
+  Uint8 folded_release = 0; // wheel whose next release is already counted
+  for (std::size_t i = 0; i < events.size(); i++) {
+    auto& ev = events[i];
+    if (IsWakeUp(ev)) {
+      // One wake-up is enough for the loop to process the whole batch
+      if (wakeup_seen) {
+        stats.folded_wakeup_events++;
+        continue;
+      }
+      wakeup_seen = true;
+    } else if (ev.type == SDL_MOUSEMOTION && len &&
+               events[len - 1].type == SDL_MOUSEMOTION) {
+      auto& folded = events[len - 1].motion;
+      folded.state = ev.motion.state;
+      folded.x = ev.motion.x;
+      folded.y = ev.motion.y;
+      folded.xrel += ev.motion.xrel;
+      folded.yrel += ev.motion.yrel;
+      stats.folded_motion_events++;
+      continue;
+    } else if (IsWheel(ev, SDL_MOUSEBUTTONDOWN) && len >= 2 &&
+               IsWheel(events[len - 2], SDL_MOUSEBUTTONDOWN) &&
+               IsWheel(events[len - 1], SDL_MOUSEBUTTONUP) &&
+               events[len - 2].button.button == ev.button.button &&
+               events[len - 1].button.button == ev.button.button) {
+      // Another tick of the same wheel, count it in the previous one
+      for (auto j : { len - 2, len - 1 }) {
+        events[j].button.x = ev.button.x;
+        events[j].button.y = ev.button.y;
+        clicks[j]++;
+      }
+      folded_release = ev.button.button;
+      stats.folded_wheel_events++;
+      continue;
+    } else if (IsWheel(ev, SDL_MOUSEBUTTONUP) &&
+               ev.button.button == folded_release) {
+      folded_release = 0;
+      stats.folded_wheel_events++;
+      continue;
+    }
+    events[len] = ev;
+    clicks[len] = clicks[i];
+    len++;
+  }
+  events.resize(len);
+  clicks.resize(len);
+}
+
+bool SDLApplicationLoop::WaitEvent(SDL_Event& event) {
+  // Don't block if there is work left to do
+  if (!ready_work_units_.empty())
+    return SDL_PollEvent(&event);
+
+  auto deadline = NextTimerDeadline();
+  if (!deadline)
+    return SDL_WaitEvent(&event);
+
+  /*
+   * SDL 1.2 cannot wait for events with a timeout. Poll for events, sleeping
+   * in between until the next scheduled work unit is due, the same way
+   * SDL_WaitEvent() does internally.
+   */
+  for (;;) {
+    if (SDL_PollEvent(&event))
+      return true;
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline.value())
+      return false;
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline.value() - now).count();
+    SDL_Delay(Uint32(remaining < 10 ? remaining + 1 : 10));
+  }
+}
+
+void SDLApplicationLoop::ProcessInput(const SDL_Event& first,
+                                      const EventTime& time) {
+  GROG_PROFILE_SCOPE("SDLApplicationLoop::ProcessInput");
+  // Process all pending input at once, so that bursts can be folded
+  input_.events.clear();
+  input_.events.push_back(first);
+  SDL_Event event;
+  while (SDL_PollEvent(&event))
+    input_.events.push_back(event);
+
+  CoalesceInput(input_, input_stats_);
+  for (std::size_t i = 0; running_ && i < input_.events.size(); i++) {
+    DispatchEvent(input_.events[i], input_.clicks[i], time);
+    input_stats_.dispatched_events++;
+  }
+}
+
+void SDLApplicationLoop::DispatchEvent(
+    SDL_Event& event, unsigned int clicks, const EventTime& time) {
+  switch (event.type) {
+    case SDL_MOUSEMOTION:
+      HandleMouseMotionEvent(ToEvent(event.motion, time));
+      break;
+    case SDL_MOUSEBUTTONUP:
+    case SDL_MOUSEBUTTONDOWN:
+      HandleMouseButtonEvent(ToEvent(event.button, clicks, time));
+      break;
+    case SDL_QUIT:
+      Stop();
+      break;
+    case SDL_USEREVENT:
+      OnUserEvent(event.user);
+      break;
   }
 }
 
 void SDLApplicationLoop::OnUserEvent(SDL_UserEvent &ev) {
   switch (ev.code) {
     case kWorkUnitPending:
-      ProcessWorkUnit();
+      // Units added from now on need a new wake-up, since they might not
+      // be seen by the next batch
+      wakeup_pending_ = false;
+      break;
   }
 }
 
-void SDLApplicationLoop::ProcessWorkUnit() {
-  auto wu = work_units_.front();
-  if (wu())
-    AddWorkUnit(wu);
-  work_units_.pop();
+void SDLApplicationLoop::ProcessWorkUnits() {
+  GROG_PROFILE_SCOPE("SDLApplicationLoop::ProcessWorkUnits");
+  WorkUnit wu;
+  while (work_units_.Pop(wu))
+    ready_work_units_.push_back(wu);
+
+  /*
+   * Run the units that were ready when the batch started. Repeating units
+   * are queued again behind them, so they run in the next batch rather than
+   * starving input processing.
+   */
+  auto start = std::chrono::steady_clock::now();
+  auto batch_size = ready_work_units_.size();
+  for (decltype(batch_size) i = 0; i < batch_size; i++) {
+    wu = ready_work_units_.front();
+    ready_work_units_.pop_front();
+    bool repeat;
+    {
+      GROG_PROFILE_SCOPE("WorkUnit");
+      repeat = wu();
+    }
+    if (repeat)
+      ready_work_units_.push_back(wu);
+
+    if (work_budget_.count() &&
+        std::chrono::steady_clock::now() - start >= work_budget_)
+      break;
+  }
 }
 
 Ptr<Screen> SDLApplicationContextFactory::CreateScreen(
@@ -178,7 +311,11 @@ Ptr<Screen> SDLApplicationContextFactory::CreateScreen(
 
 Ptr<ApplicationLoop> SDLApplicationContextFactory::CreateLoop(
     const Application::Properties &props) {
-  return SDLApplicationLoop::instance();
+  auto loop = SDLApplicationLoop::instance();
+  loop->set_work_budget(std::chrono::milliseconds(
+      Application::ParseProperty<unsigned>(
+          props.at(Application::kPropNameLoopWorkBudget))));
+  return loop;
 }
 
 }} // namespace grog::ui
@@ -18,16 +18,21 @@
 
 #include "grog/ui/app.h"
 
+#include <algorithm>
+#include <fstream>
+#include <iostream>
 #include <string>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
 
+#include "grog/ui/app-headless.h"
 #include "grog/ui/app-sdl.h"
 #include "grog/ui/draw-gl.h"
 #include "grog/ui/draw-sdl.h"
 #include "grog/ui/event-sdl.h"
 #include "grog/ui/widget.h"
+#include "grog/util/profile.h"
 
 #ifdef __MACOSX__
 #include "grog/ui/app-cocoa.h"
@@ -47,44 +52,253 @@ Application::Properties InitDefaultProperties() {
   props["screen-depth"] = "32";
   props["screen-double-buffer"] = "yes";
   props["app-engine"] = "sdl";
+  props["loop-work-budget"] = "10";
+  props["latency-report"] = "no";
+  props["frame-rate"] = "60";
+  props["layer-budget"] = "64";
+  props["profile-trace"] = "";
   return props;
 }
 
 } // anonymous namespace
 
+AbstractApplicationLoop::AbstractApplicationLoop()
+  : epoch_(std::chrono::steady_clock::now()) {}
+
+void AbstractApplicationLoop::ScheduleWorkUnit(
+    const WorkUnit& wu, const Duration& delay) {
+  Timer timer = {
+    wu, Duration::zero(), std::chrono::steady_clock::now() + delay
+  };
+  Schedule(timer);
+}
+
+void AbstractApplicationLoop::ScheduleRepeating(
+    const WorkUnit& wu, const Duration& interval) {
+  Timer timer = { wu, interval, std::chrono::steady_clock::now() + interval };
+  Schedule(timer);
+}
+
+Option<std::chrono::steady_clock::time_point>
+AbstractApplicationLoop::NextTimerDeadline() const {
+  auto deadline = timers_.NextDeadline();
+  return deadline ?
+      Option<std::chrono::steady_clock::time_point>::Some(
+          epoch_ + Duration(deadline.value())) :
+      Option<std::chrono::steady_clock::time_point>::None();
+}
+
+void AbstractApplicationLoop::RunExpiredTimers() {
+  auto now = std::chrono::steady_clock::now();
+  expired_timers_.clear();
+  timers_.Advance(ToTicks(now), expired_timers_);
+  for (auto& timer : expired_timers_) {
+    bool repeat = timer.wu();
+    if (repeat && timer.interval != Duration::zero()) {
+      // Keep the period stable, unless we fell behind a whole interval
+      timer.deadline += timer.interval;
+      if (timer.deadline <= now)
+        timer.deadline = now + timer.interval;
+      Schedule(timer);
+    }
+  }
+}
+
+AbstractApplicationLoop::TimerWheel::Ticks AbstractApplicationLoop::ToTicks(
+    const std::chrono::steady_clock::time_point& time) const {
+  auto ticks = std::chrono::duration_cast<Duration>(time - epoch_).count();
+  return ticks > 0 ? TimerWheel::Ticks(ticks) : 0;
+}
+
+void AbstractApplicationLoop::Schedule(const Timer& timer) {
+  // Round up, so work units are never executed before their deadline
+  auto ticks = ToTicks(timer.deadline);
+  if (epoch_ + Duration(ticks) < timer.deadline)
+    ticks++;
+  timers_.Schedule(ticks, timer);
+}
+
 DefaultApplicationContext::DefaultApplicationContext(
     const Ptr<ApplicationLoop>& loop, const Ptr<Screen>& screen)
-  : loop_(loop), screen_(screen), post_redisplay_requested_(false) {
-  loop_->RegisterMouseMotionEventHandler([this](const MouseMotionEvent& ev) {
-    auto win = window();
-    if (win)
-      win->Respond(ev);
-  });
-  loop_->RegisterMouseButtonEventHandler([this](const MouseButtonEvent& ev) {
-    auto win = window();
-    if (win)
-      win->Respond(ev);
-  });
-}
-
-
-void DefaultApplicationContext::PostRedisplay()
-{
-  if (!post_redisplay_requested_) {
-    post_redisplay_requested_ = true;
-    loop().AddWorkUnit([this]() {
-      auto& scr = screen();
+  : loop_(loop), screen_(screen), frame_requested_(false),
+    frame_interval_(0) {
+  mouse_motion_token_ = loop_->RegisterMouseMotionEventHandler(
+      [this](const MouseMotionEvent& ev) { DispatchInput(ev); });
+  mouse_button_token_ = loop_->RegisterMouseButtonEventHandler(
+      [this](const MouseButtonEvent& ev) { DispatchInput(ev); });
+}
+
+DefaultApplicationContext::~DefaultApplicationContext() {
+  // The loop may outlive this context
+  loop_->UnregisterMouseMotionEventHandler(mouse_motion_token_);
+  loop_->UnregisterMouseButtonEventHandler(mouse_button_token_);
+  for (auto& ref : deferred_channels_) {
+    auto channel = ref.lock();
+    if (channel)
+      channel->set_flush_scheduler(nullptr);
+  }
+}
+
+
+void DefaultApplicationContext::PostRedisplay() {
+  PostRedisplay(Rect2<int>(Vector2<int>(0, 0), screen().size()));
+}
+
+void DefaultApplicationContext::PostRedisplay(const Rect2<int>& region) {
+  damage_.Add(region.Intersection(
+      Rect2<int>(Vector2<int>(0, 0), screen().size())));
+  if (damage_.empty())
+    return;
+
+  // The frame will present the response to the input being dispatched
+  if (dispatched_input_time_ != EventTime() &&
+      (damage_input_time_ == EventTime() ||
+       dispatched_input_time_ < damage_input_time_))
+    damage_input_time_ = dispatched_input_time_;
+  RequestFrame();
+}
+
+void DefaultApplicationContext::DeferNotifications(
+    const Ptr<util::NotificationChannel>& channel) {
+  deferred_channels_.push_back(channel);
+  channel->set_flush_scheduler([this]() { RequestFrame(); });
+  if (channel->pending())
+    RequestFrame();
+}
+
+void DefaultApplicationContext::RequestFrame() {
+  if (frame_requested_)
+    return;
+  frame_requested_ = true;
+  auto wu = [this]() {
+    DrawFrame();
+
+    // Remove work unit, will be inserted when a new frame is requested
+    return false;
+  };
+
+  auto now = std::chrono::steady_clock::now();
+  if (now >= next_frame_time_) {
+    loop().AddWorkUnit(wu);
+  } else {
+    // Round up, so the frame is never drawn before its slot
+    auto delay = std::chrono::duration_cast<ApplicationLoop::Duration>(
+        next_frame_time_ - now);
+    if (delay < next_frame_time_ - now)
+      delay += ApplicationLoop::Duration(1);
+    loop().ScheduleWorkUnit(wu, delay);
+  }
+}
+
+void DefaultApplicationContext::DrawFrame() {
+  GROG_PROFILE_SCOPE("DefaultApplicationContext::DrawFrame");
+  auto start = std::chrono::steady_clock::now();
+
+  // Notifications go first, since their subscribers may post redisplays
+  FlushNotifications();
+  if (!damage_.empty()) {
+    Redisplay();
+    auto end = std::chrono::steady_clock::now();
+    frame_stats_.frames++;
+    frame_stats_.frame_time.Record(
+        std::chrono::duration_cast<FrameStats::Duration>(end - start));
+    ScheduleNextFrame(start, end);
+  }
+  frame_requested_ = false;
+
+  // Notifications posted while flushing found the frame already requested
+  for (auto& ref : deferred_channels_) {
+    auto channel = ref.lock();
+    if (channel && channel->pending())
+      RequestFrame();
+  }
+}
+
+void DefaultApplicationContext::ScheduleNextFrame(
+    const std::chrono::steady_clock::time_point& start,
+    const std::chrono::steady_clock::time_point& end) {
+  if (frame_interval_ == FrameStats::Duration::zero())
+    return;
+
+  // Keep the slots of an ongoing animation, start new ones after idling
+  auto slot = next_frame_time_;
+  if (start - slot >= frame_interval_)
+    slot = start;
+  auto next = slot + frame_interval_;
+
+  // Drawing the next frame right away would only make it late as well
+  if (end > next) {
+    auto missed = (end - next) / frame_interval_ + 1;
+    frame_stats_.skipped += missed;
+    next += missed * frame_interval_;
+  }
+  next_frame_time_ = next;
+}
+
+void DefaultApplicationContext::FlushNotifications() {
+  GROG_PROFILE_SCOPE("DefaultApplicationContext::FlushNotifications");
+  auto expired = [](const ChannelRef& ref) { return ref.expired(); };
+  deferred_channels_.erase(std::remove_if(
+      deferred_channels_.begin(), deferred_channels_.end(), expired),
+      deferred_channels_.end());
+
+  // Copy, subscribers may defer notifications of further channels
+  auto channels = deferred_channels_;
+  for (auto& ref : channels) {
+    auto channel = ref.lock();
+    if (channel)
+      channel->Flush();
+  }
+}
+
+void DefaultApplicationContext::Redisplay() {
+  GROG_PROFILE_SCOPE("DefaultApplicationContext::Redisplay");
+  /*
+   * The contents of the back buffer are undefined after swapping, but most
+   * implementations simply exchange front and back buffers. Repainting the
+   * damage of the previous frame as well brings the back buffer up to date.
+   */
+  DamageRegion region(damage_);
+  region.Add(last_damage_);
+  last_damage_ = damage_;
+  damage_.Clear();
+  auto input_time = damage_input_time_;
+  damage_input_time_ = EventTime();
+
+  auto& scr = screen();
+  auto win = window();
+  Rect2<int> screen_region(Vector2<int>(0, 0), scr.size());
+  for (auto& rect : region.rects()) {
+    scr.set_clip(rect);
+    {
+      GROG_PROFILE_SCOPE("Screen::Clear");
       scr.Clear();
-      auto win = window();
-      if (win)
-        win->Draw(Rect2<int>(Vector2<int>(0, 0), scr.size()));
-      scr.Flush();
+    }
+    if (win) {
+      GROG_PROFILE_SCOPE("Window::Draw");
+      win->Render(screen_region);
+    }
+  }
+  scr.ResetClip();
+  {
+    GROG_PROFILE_SCOPE("Screen::Flush");
+    scr.Flush();
+  }
 
-      post_redisplay_requested_ = false;
+  if (input_time != EventTime()) {
+    input_latency_.Record(
+        std::chrono::duration_cast<util::LatencyHistogram::Duration>(
+            std::chrono::steady_clock::now() - input_time));
+  }
+}
 
-      // Remove work unit, will be inserted when post redisplay is requested
-      return false;
-    });
+template <typename Event>
+void DefaultApplicationContext::DispatchInput(const Event& ev) {
+  auto win = window();
+  if (win) {
+    dispatched_input_time_ = ev.time;
+    win->Respond(ev);
+    dispatched_input_time_ = EventTime();
   }
 }
 
@@ -100,8 +314,14 @@ const PropName Application::kPropNameScreenHeight("screen-height");
 const PropName Application::kPropNameScreenDepth("screen-depth");
 const PropName Application::kPropNameScreenDoubleBuffer("screen-double-buffer");
 const PropName Application::kPropNameAppEngine("app-engine");
+const PropName Application::kPropNameLoopWorkBudget("loop-work-budget");
+const PropName Application::kPropNameLatencyReport("latency-report");
+const PropName Application::kPropNameFrameRate("frame-rate");
+const PropName Application::kPropNameLayerBudget("layer-budget");
+const PropName Application::kPropNameProfileTrace("profile-trace");
 
 const PropName Application::kPropValueSDLAppEngine("sdl");
+const PropName Application::kPropValueSoftwareAppEngine("software");
 
 const Application::Properties Application::kDefaultProperties =
     InitDefaultProperties();
@@ -124,6 +344,24 @@ Application::~Application() {
 
 void Application::Run() {
   context_->loop().Run();
+
+  auto report = props_.find(kPropNameLatencyReport);
+  if (report != props_.end() && ParseProperty<bool>(report->second)) {
+    auto& latency = context_->input_latency();
+    auto ms = [](const util::LatencyHistogram::Duration& d) {
+      return d.count() / 1000.0;
+    };
+    std::cerr << boost::format(
+        "input-to-photon latency: %d frames, p50 %.3f ms, p99 %.3f ms, "
+        "max %.3f ms") % latency.count() % ms(latency.Percentile(50)) %
+        ms(latency.Percentile(99)) % ms(latency.max()) << std::endl;
+  }
+
+  auto trace = props_.find(kPropNameProfileTrace);
+  if (trace != props_.end() && !trace->second.empty()) {
+    std::ofstream out(trace->second.c_str());
+    util::Profiler::instance().ExportChromeTrace(out);
+  }
 }
 
 Ptr<Window> Application::NewWindow() {
@@ -149,6 +387,8 @@ Ptr<ApplicationContext> Application::InitContext(
       return SDLApplicationContextFactory().CreateContext(props);
   #endif
     }
+    if (prop_value == kPropValueSoftwareAppEngine)
+      return SoftwareApplicationContextFactory().CreateContext(props);
   } catch (util::Error& e) {
     GROG_THROW_ERROR(InitError() << util::NestedErrorInfo(e));
   }
@@ -156,14 +396,29 @@ Ptr<ApplicationContext> Application::InitContext(
   // Unknown app engine
   GROG_THROW_ERROR(InvalidConfigError() <<
       ActualPropertyValueInfo(prop_value) <<
-      ExpectedPropertyValueInfo("[sdl]"));
+      ExpectedPropertyValueInfo("[sdl, software]"));
 }
 
 Ptr<ApplicationContext> ApplicationContextFactory::CreateContext(
     const Application::Properties &props) {
   auto loop = CreateLoop(props);
   auto screen = CreateScreen(props);
-  return new DefaultApplicationContext(loop, screen);
+  Ptr<DefaultApplicationContext> context(
+      new DefaultApplicationContext(loop, screen));
+
+  auto frame_rate = props.find(Application::kPropNameFrameRate);
+  if (frame_rate != props.end()) {
+    auto rate = Application::ParseProperty<unsigned>(frame_rate->second);
+    if (rate)
+      context->set_frame_interval(FrameStats::Duration(1000000 / rate));
+  }
+
+  auto layer_budget = props.find(Application::kPropNameLayerBudget);
+  if (layer_budget != props.end()) {
+    screen->layer_cache().set_budget(std::size_t(1024 * 1024) *
+        Application::ParseProperty<unsigned>(layer_budget->second));
+  }
+  return context;
 }
 
 }} // namespace grog::ui
@@ -20,11 +20,30 @@
 
 namespace grog { namespace ui {
 
-Color Color::kBlue= { 0.0f, 0.0f, 1.0f, 1.0f };
-Color Color::kGreen = { 0.0f, 1.0f, 0.0f, 1.0f };
-Color Color::kLightBlue= { 0.5f, 0.5f, 1.0f, 1.0f };
-Color Color::kLightGreen = { 0.5f, 1.0f, 0.5f, 1.0f };
-Color Color::kLightRed = { 1.0f, 0.5f, 0.5f, 1.0f };
-Color Color::kRed = { 1.0f, 0.0f, 0.0f, 1.0f };
+namespace {
+
+constexpr Color kBlueValue = { 0.0f, 0.0f, 1.0f, 1.0f };
+constexpr Color kGreenValue = { 0.0f, 1.0f, 0.0f, 1.0f };
+constexpr Color kLightBlueValue = { 0.5f, 0.5f, 1.0f, 1.0f };
+constexpr Color kLightGreenValue = { 0.5f, 1.0f, 0.5f, 1.0f };
+constexpr Color kLightRedValue = { 1.0f, 0.5f, 0.5f, 1.0f };
+constexpr Color kRedValue = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+} // anonymous namespace
+
+Color Color::kBlue = kBlueValue;
+Color Color::kGreen = kGreenValue;
+Color Color::kLightBlue = kLightBlueValue;
+Color Color::kLightGreen = kLightGreenValue;
+Color Color::kLightRed = kLightRedValue;
+Color Color::kRed = kRedValue;
+
+// Packed at compile time, so they are usable during static initialization
+const PackedColor PackedColor::kBlue(kBlueValue);
+const PackedColor PackedColor::kGreen(kGreenValue);
+const PackedColor PackedColor::kLightBlue(kLightBlueValue);
+const PackedColor PackedColor::kLightGreen(kLightGreenValue);
+const PackedColor PackedColor::kLightRed(kLightRedValue);
+const PackedColor PackedColor::kRed(kRedValue);
 
 }} // namespace grog::ui
@@ -0,0 +1,66 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "grog/ui/damage.h"
+
+namespace grog { namespace ui {
+
+Rect2<int> DamageRegion::bounds() const {
+  Rect2<int> result(0, 0, 0, 0);
+  for (auto& rect : rects_)
+    result = result.Union(rect);
+  return result;
+}
+
+void DamageRegion::Add(const Rect2<int>& rect) {
+  if (rect.empty())
+    return;
+
+  // Absorb every overlapping rectangle, growing the new one until it
+  // overlaps nothing else
+  Rect2<int> merged(rect);
+  bool absorbed = true;
+  while (absorbed) {
+    absorbed = false;
+    for (auto it = rects_.begin(); it != rects_.end(); ++it) {
+      if (it->Contains(merged))
+        return;
+      if (it->Intersects(merged)) {
+        merged = merged.Union(*it);
+        rects_.erase(it);
+        absorbed = true;
+        break;
+      }
+    }
+  }
+
+  if (rects_.size() < max_rects_) {
+    rects_.push_back(merged);
+  } else {
+    merged = merged.Union(bounds());
+    rects_.clear();
+    rects_.push_back(merged);
+  }
+}
+
+void DamageRegion::Add(const DamageRegion& region) {
+  for (auto& rect : region.rects_)
+    Add(rect);
+}
+
+}} // namespace grog::ui
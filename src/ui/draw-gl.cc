@@ -18,6 +18,12 @@
 
 #include "grog/ui/draw-gl.h"
 
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <utility>
+
 #include "grog/util/platform.h" // required for platform-dependent includes
 
 #if GROG_PLATFORM == GROG_PLATFORM_OSX
@@ -29,59 +35,771 @@
   #include <GL/gl.h>
 #endif
 
+#ifndef APIENTRY
+  #define APIENTRY
+#endif
+
 namespace grog { namespace ui {
 
+namespace {
+
+bool HasExtension(const char* name) {
+  auto extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (!extensions)
+    return false;
+
+  // Names may be prefixes of others, match whole space-separated words
+  auto length = std::strlen(name);
+  for (auto match = std::strstr(extensions, name); match;
+       match = std::strstr(match + length, name)) {
+    bool starts = match == extensions || match[-1] == ' ';
+    bool ends = match[length] == ' ' || match[length] == '\0';
+    if (starts && ends)
+      return true;
+  }
+  return false;
+}
+
+bool HasVersion(int major, int minor) {
+  auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  int version_major = 0, version_minor = 0;
+  if (!version ||
+      std::sscanf(version, "%d.%d", &version_major, &version_minor) != 2)
+    return false;
+  return version_major > major ||
+      (version_major == major && version_minor >= minor);
+}
+
+} // anonymous namespace
+
+/*
+ * The entry points of EXT_framebuffer_object, which OpenGL 1.1 headers
+ * don't declare.
+ */
+struct OpenGLFramebufferFunctions {
+  typedef void (APIENTRY *GenFramebuffers)(GLsizei, GLuint*);
+  typedef void (APIENTRY *DeleteFramebuffers)(GLsizei, const GLuint*);
+  typedef void (APIENTRY *BindFramebuffer)(GLenum, GLuint);
+  typedef void (APIENTRY *FramebufferTexture2D)(
+      GLenum, GLenum, GLenum, GLuint, GLint);
+  typedef GLenum (APIENTRY *CheckFramebufferStatus)(GLenum);
+
+  static const GLenum kFramebuffer = 0x8D40;
+  static const GLenum kColorAttachment0 = 0x8CE0;
+  static const GLenum kFramebufferComplete = 0x8CD5;
+
+  GenFramebuffers gen;
+  DeleteFramebuffers del;
+  BindFramebuffer bind;
+  FramebufferTexture2D texture_2d;
+  CheckFramebufferStatus check_status;
+
+  /*
+   * Load the functions from given context, or return null if any of them
+   * is not available.
+   */
+  static Ptr<OpenGLFramebufferFunctions> Load(OpenGLContext& ctx) {
+    Ptr<OpenGLFramebufferFunctions> fbo(new OpenGLFramebufferFunctions());
+    fbo->gen = reinterpret_cast<GenFramebuffers>(
+        ctx.GetProcAddress("glGenFramebuffersEXT"));
+    fbo->del = reinterpret_cast<DeleteFramebuffers>(
+        ctx.GetProcAddress("glDeleteFramebuffersEXT"));
+    fbo->bind = reinterpret_cast<BindFramebuffer>(
+        ctx.GetProcAddress("glBindFramebufferEXT"));
+    fbo->texture_2d = reinterpret_cast<FramebufferTexture2D>(
+        ctx.GetProcAddress("glFramebufferTexture2DEXT"));
+    fbo->check_status = reinterpret_cast<CheckFramebufferStatus>(
+        ctx.GetProcAddress("glCheckFramebufferStatusEXT"));
+    if (!fbo->gen || !fbo->del || !fbo->bind || !fbo->texture_2d ||
+        !fbo->check_status)
+      return nullptr;
+    return fbo;
+  }
+};
+
+/*
+ * Tracks the GL state set by a screen, so changes to the state already set
+ * are filtered rather than issued to the driver. State is unknown until it
+ * is first set, or after it is invalidated.
+ */
+class OpenGLStateCache : util::NonCopyable {
+public:
+
+  OpenGLStateCache(OpenGLContext& ctx)
+    : scissor_(Rect2<int>(0, 0, 0, 0)), viewport_(Rect2<int>(0, 0, 0, 0)),
+      projection_(Rect2<int>(0, 0, 0, 0)), blend_func_separate_(nullptr) {
+    ResetStats();
+
+    // OpenGL 1.1 can't blend alpha apart from color, as layers require
+    const char* name = HasVersion(1, 4) ? "glBlendFuncSeparate" :
+        HasExtension("GL_EXT_blend_func_separate") ?
+            "glBlendFuncSeparateEXT" : nullptr;
+    if (name)
+      blend_func_separate_ = reinterpret_cast<BlendFuncSeparate>(
+          ctx.GetProcAddress(name));
+  }
+
+  inline const OpenGLScreen::StateStats& stats() const { return stats_; }
+
+  inline void ResetStats() { stats_.issued = stats_.filtered = 0; }
+
+  void Invalidate() {
+    capabilities_.clear();
+    client_states_.clear();
+    color_.known = clear_color_.known = blend_func_.known = false;
+    texture_.known = framebuffer_.known = false;
+    scissor_.known = viewport_.known = projection_.known = false;
+  }
+
+  /*
+   * Forget the current color, which is undefined after drawing with a
+   * color array.
+   */
+  inline void InvalidateColor() { color_.known = false; }
+
+  void SetCapability(GLenum capability, bool enabled) {
+    if (Update(capabilities_[capability], enabled)) {
+      if (enabled)
+        glEnable(capability);
+      else
+        glDisable(capability);
+    }
+  }
+
+  void SetClientState(GLenum array, bool enabled) {
+    if (Update(client_states_[array], enabled)) {
+      if (enabled)
+        glEnableClientState(array);
+      else
+        glDisableClientState(array);
+    }
+  }
+
+  void Color(const PackedColor& color) {
+    if (Update(color_, color))
+      glColor4ub(color.r(), color.g(), color.b(), color.a());
+  }
+
+  void ClearColor(const PackedColor& color) {
+    if (Update(clear_color_, color))
+      glClearColor(color.r() / 255.0f, color.g() / 255.0f,
+                   color.b() / 255.0f, color.a() / 255.0f);
+  }
+
+  /*
+   * Set the blend factors for color and alpha. Alpha is blended as color
+   * if the driver can't blend them apart.
+   */
+  void BlendFunc(GLenum src_color, GLenum dst_color,
+                 GLenum src_alpha, GLenum dst_alpha) {
+    BlendFactors factors = {{ src_color, dst_color, src_alpha, dst_alpha }};
+    if (Update(blend_func_, factors)) {
+      if (blend_func_separate_)
+        blend_func_separate_(src_color, dst_color, src_alpha, dst_alpha);
+      else
+        glBlendFunc(src_color, dst_color);
+    }
+  }
+
+  inline void BlendFunc(GLenum src, GLenum dst) {
+    BlendFunc(src, dst, src, dst);
+  }
+
+  void BindTexture(GLuint texture) {
+    if (Update(texture_, texture))
+      glBindTexture(GL_TEXTURE_2D, texture);
+  }
+
+  void DeleteTexture(GLuint texture) {
+    // Deleting the bound texture binds the default one
+    if (texture_.known && texture_.value == texture)
+      texture_.value = 0;
+    glDeleteTextures(1, &texture);
+  }
+
+  void BindFramebuffer(const OpenGLFramebufferFunctions& fbo,
+                       GLuint framebuffer) {
+    if (Update(framebuffer_, framebuffer))
+      fbo.bind(OpenGLFramebufferFunctions::kFramebuffer, framebuffer);
+  }
+
+  void DeleteFramebuffer(const OpenGLFramebufferFunctions& fbo,
+                         GLuint framebuffer) {
+    if (framebuffer_.known && framebuffer_.value == framebuffer)
+      framebuffer_.value = 0;
+    fbo.del(1, &framebuffer);
+  }
+
+  /*
+   * Check whether the scissor test is set as given, with given box if
+   * enabled.
+   */
+  bool HasScissor(bool enabled, const Rect2<int>& box) const {
+    auto test = capabilities_.find(GL_SCISSOR_TEST);
+    if (test == capabilities_.end() || !test->second.known ||
+        test->second.value != enabled)
+      return false;
+    return !enabled || (scissor_.known && scissor_.value == box);
+  }
+
+  void Scissor(const Rect2<int>& box) {
+    if (Update(scissor_, box))
+      glScissor(box.x, box.y, box.w, box.h);
+  }
+
+  void Viewport(const Rect2<int>& box) {
+    if (Update(viewport_, box))
+      glViewport(box.x, box.y, box.w, box.h);
+  }
+
+  /*
+   * Set an orthographic projection of given region, with the origin at the
+   * top-left, and identity model-view matrix.
+   */
+  void Projection(const Rect2<int>& region) {
+    if (Update(projection_, region)) {
+      glMatrixMode(GL_PROJECTION);
+      glLoadIdentity();
+      glOrtho(GLdouble(region.x),
+              GLdouble(region.x + region.w),
+              GLdouble(region.y + region.h),
+              GLdouble(region.y),
+              0.0,
+              1.0);
+      glMatrixMode(GL_MODELVIEW);
+      glLoadIdentity();
+    }
+  }
+
+private:
+
+  template <typename T>
+  struct State {
+    T value;
+    bool known;
+
+    inline State() : value(), known(false) {}
+
+    inline State(const T& value) : value(value), known(false) {}
+  };
+
+  typedef void (APIENTRY *BlendFuncSeparate)(GLenum, GLenum, GLenum, GLenum);
+  typedef std::array<GLenum, 4> BlendFactors;
+
+  OpenGLScreen::StateStats stats_;
+  BlendFuncSeparate blend_func_separate_;
+  std::map<GLenum, State<bool>> capabilities_;
+  std::map<GLenum, State<bool>> client_states_;
+  State<PackedColor> color_;
+  State<PackedColor> clear_color_;
+  State<BlendFactors> blend_func_;
+  State<GLuint> texture_;
+  State<GLuint> framebuffer_;
+  State<Rect2<int>> scissor_;
+  State<Rect2<int>> viewport_;
+  State<Rect2<int>> projection_;
+
+  /*
+   * Set given state to given value, and return whether it changed, so the
+   * change must be issued.
+   */
+  template <typename T>
+  bool Update(State<T>& state, const T& value) {
+    if (state.known && state.value == value) {
+      stats_.filtered++;
+      return false;
+    }
+    state.value = value;
+    state.known = true;
+    stats_.issued++;
+    return true;
+  }
+};
+
+/*
+ * Draws the quads of a batch as instances of a unit quad, with a single
+ * instanced call. Fixed function pipeline cannot read per instance data, so
+ * a minimal GLSL program scales and translates the unit quad by the region
+ * of each instance. The entry points of ARB_instanced_arrays,
+ * ARB_draw_instanced and OpenGL 2.0 shaders are not declared by OpenGL 1.1
+ * headers.
+ */
+struct OpenGLInstancedRenderer {
+  typedef GLuint (APIENTRY *CreateShader)(GLenum);
+  typedef void (APIENTRY *ShaderSource)(
+      GLuint, GLsizei, const char* const*, const GLint*);
+  typedef void (APIENTRY *CompileShader)(GLuint);
+  typedef void (APIENTRY *GetShaderiv)(GLuint, GLenum, GLint*);
+  typedef void (APIENTRY *DeleteShader)(GLuint);
+  typedef GLuint (APIENTRY *CreateProgram)();
+  typedef void (APIENTRY *AttachShader)(GLuint, GLuint);
+  typedef void (APIENTRY *BindAttribLocation)(GLuint, GLuint, const char*);
+  typedef void (APIENTRY *LinkProgram)(GLuint);
+  typedef void (APIENTRY *GetProgramiv)(GLuint, GLenum, GLint*);
+  typedef void (APIENTRY *UseProgram)(GLuint);
+  typedef void (APIENTRY *DeleteProgram)(GLuint);
+  typedef void (APIENTRY *EnableVertexAttribArray)(GLuint);
+  typedef void (APIENTRY *DisableVertexAttribArray)(GLuint);
+  typedef void (APIENTRY *VertexAttribPointer)(
+      GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+  typedef void (APIENTRY *VertexAttribDivisor)(GLuint, GLuint);
+  typedef void (APIENTRY *DrawArraysInstanced)(GLenum, GLint, GLsizei, GLsizei);
+
+  static const GLenum kVertexShader = 0x8B31;
+  static const GLenum kFragmentShader = 0x8B30;
+  static const GLenum kCompileStatus = 0x8B81;
+  static const GLenum kLinkStatus = 0x8B82;
+
+  // Attribute locations, the corner takes 0 as it aliases the vertex position
+  static const GLuint kCornerAttrib = 0;
+  static const GLuint kRegionAttrib = 1;
+  static const GLuint kColorAttrib = 2;
+
+  CreateShader create_shader;
+  ShaderSource shader_source;
+  CompileShader compile_shader;
+  GetShaderiv get_shader;
+  DeleteShader delete_shader;
+  CreateProgram create_program;
+  AttachShader attach_shader;
+  BindAttribLocation bind_attrib_location;
+  LinkProgram link_program;
+  GetProgramiv get_program;
+  UseProgram use_program;
+  DeleteProgram delete_program;
+  EnableVertexAttribArray enable_attrib_array;
+  DisableVertexAttribArray disable_attrib_array;
+  VertexAttribPointer attrib_pointer;
+  VertexAttribDivisor attrib_divisor;
+  DrawArraysInstanced draw_arrays_instanced;
+
+  GLuint program;
+
+  inline OpenGLInstancedRenderer() : program(0) {}
+
+  inline ~OpenGLInstancedRenderer() {
+    if (program)
+      delete_program(program);
+  }
+
+  /*
+   * Load the functions from given context and build the program, or return
+   * null if instancing is not supported.
+   */
+  static Ptr<OpenGLInstancedRenderer> Load(OpenGLContext& ctx) {
+    // Drivers may resolve functions they don't implement, check extensions
+    if (!HasExtension("GL_ARB_instanced_arrays") ||
+        !HasExtension("GL_ARB_draw_instanced") ||
+        !HasExtension("GL_ARB_shading_language_100"))
+      return nullptr;
+
+    Ptr<OpenGLInstancedRenderer> renderer(new OpenGLInstancedRenderer());
+    auto& r = *renderer;
+    bool loaded =
+        LoadFunction(ctx, "glCreateShader", r.create_shader) &&
+        LoadFunction(ctx, "glShaderSource", r.shader_source) &&
+        LoadFunction(ctx, "glCompileShader", r.compile_shader) &&
+        LoadFunction(ctx, "glGetShaderiv", r.get_shader) &&
+        LoadFunction(ctx, "glDeleteShader", r.delete_shader) &&
+        LoadFunction(ctx, "glCreateProgram", r.create_program) &&
+        LoadFunction(ctx, "glAttachShader", r.attach_shader) &&
+        LoadFunction(ctx, "glBindAttribLocation", r.bind_attrib_location) &&
+        LoadFunction(ctx, "glLinkProgram", r.link_program) &&
+        LoadFunction(ctx, "glGetProgramiv", r.get_program) &&
+        LoadFunction(ctx, "glUseProgram", r.use_program) &&
+        LoadFunction(ctx, "glDeleteProgram", r.delete_program) &&
+        LoadFunction(ctx, "glEnableVertexAttribArray",
+                     r.enable_attrib_array) &&
+        LoadFunction(ctx, "glDisableVertexAttribArray",
+                     r.disable_attrib_array) &&
+        LoadFunction(ctx, "glVertexAttribPointer", r.attrib_pointer) &&
+        LoadFunction(ctx, "glVertexAttribDivisorARB", r.attrib_divisor) &&
+        LoadFunction(ctx, "glDrawArraysInstancedARB",
+                     r.draw_arrays_instanced);
+    if (!loaded || !r.BuildProgram())
+      return nullptr;
+    return renderer;
+  }
+
+  /*
+   * Draw given quads with a single instanced call.
+   */
+  void Draw(const OpenGLRenderBatch::Quad* quads, std::size_t count) {
+    // The unit quad, drawn as a triangle fan
+    static const float kCorners[] = { 0, 0, 1, 0, 1, 1, 0, 1 };
+    const GLsizei stride = sizeof(OpenGLRenderBatch::Quad);
+
+    use_program(program);
+    enable_attrib_array(kCornerAttrib);
+    enable_attrib_array(kRegionAttrib);
+    enable_attrib_array(kColorAttrib);
+    attrib_pointer(kCornerAttrib, 2, GL_FLOAT, GL_FALSE, 0, kCorners);
+    attrib_pointer(kRegionAttrib, 4, GL_FLOAT, GL_FALSE, stride, &quads->x);
+    attrib_pointer(kColorAttrib, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                   &quads->color);
+    attrib_divisor(kRegionAttrib, 1);
+    attrib_divisor(kColorAttrib, 1);
+
+    draw_arrays_instanced(GL_TRIANGLE_FAN, 0, 4, GLsizei(count));
+
+    attrib_divisor(kColorAttrib, 0);
+    attrib_divisor(kRegionAttrib, 0);
+    disable_attrib_array(kColorAttrib);
+    disable_attrib_array(kRegionAttrib);
+    disable_attrib_array(kCornerAttrib);
+    use_program(0);
+  }
+
+private:
+
+  template <typename Function>
+  static bool LoadFunction(OpenGLContext& ctx, const char* name,
+                           Function& function) {
+    function = reinterpret_cast<Function>(ctx.GetProcAddress(name));
+    return function != nullptr;
+  }
+
+  GLuint BuildShader(GLenum type, const char* source) {
+    GLuint shader = create_shader(type);
+    GLint compiled = GL_FALSE;
+    shader_source(shader, 1, &source, nullptr);
+    compile_shader(shader);
+    get_shader(shader, kCompileStatus, &compiled);
+    if (compiled != GL_TRUE) {
+      delete_shader(shader);
+      return 0;
+    }
+    return shader;
+  }
+
+  bool BuildProgram() {
+    // Fixed function matrices keep working with the projection of the screen
+    static const char* kVertexSource =
+        "#version 110\n"
+        "attribute vec2 corner;\n"
+        "attribute vec4 region;\n"
+        "attribute vec4 color;\n"
+        "varying vec4 fill_color;\n"
+        "void main() {\n"
+        "  vec2 pos = region.xy + corner * region.zw;\n"
+        "  gl_Position = gl_ModelViewProjectionMatrix * vec4(pos, 0.0, 1.0);\n"
+        "  fill_color = color;\n"
+        "}\n";
+    static const char* kFragmentSource =
+        "#version 110\n"
+        "varying vec4 fill_color;\n"
+        "void main() {\n"
+        "  gl_FragColor = fill_color;\n"
+        "}\n";
+
+    GLuint vertex_shader = BuildShader(kVertexShader, kVertexSource);
+    GLuint fragment_shader = BuildShader(kFragmentShader, kFragmentSource);
+    if (vertex_shader && fragment_shader) {
+      program = create_program();
+      attach_shader(program, vertex_shader);
+      attach_shader(program, fragment_shader);
+      bind_attrib_location(program, kCornerAttrib, "corner");
+      bind_attrib_location(program, kRegionAttrib, "region");
+      bind_attrib_location(program, kColorAttrib, "color");
+      link_program(program);
+    }
+
+    // Shaders are released along with the program they are attached to
+    if (vertex_shader)
+      delete_shader(vertex_shader);
+    if (fragment_shader)
+      delete_shader(fragment_shader);
+
+    GLint linked = GL_FALSE;
+    if (program)
+      get_program(program, kLinkStatus, &linked);
+    return linked == GL_TRUE;
+  }
+};
+
+namespace {
+
+class OpenGLLayer : public Layer {
+public:
+
+  inline OpenGLLayer(const Ptr<OpenGLFramebufferFunctions>& fbo,
+                     const Ptr<OpenGLStateCache>& state,
+                     const Vector2<int>& size,
+                     const Vector2<int>& texture_size,
+                     GLuint texture,
+                     GLuint framebuffer)
+    : Layer(size, texture_size.x * texture_size.y * 4),
+      texture_size(texture_size), texture(texture),
+      framebuffer(framebuffer), fbo_(fbo), state_(state) {}
+
+  inline virtual ~OpenGLLayer() {
+    state_->DeleteFramebuffer(*fbo_, framebuffer);
+    state_->DeleteTexture(texture);
+  }
+
+  Vector2<int> texture_size;
+  GLuint texture;
+  GLuint framebuffer;
+
+private:
+
+  Ptr<OpenGLFramebufferFunctions> fbo_;
+  Ptr<OpenGLStateCache> state_;
+};
+
+int NextPowerOfTwo(int value) {
+  int power = 1;
+  while (power < value)
+    power <<= 1;
+  return power;
+}
+
+} // anonymous namespace
+
+OpenGLRenderBatch::OpenGLRenderBatch(OpenGLStateCache& state)
+  : state_(state), primitive_count_(0) {
+  ResetStats();
+}
+
+void OpenGLRenderBatch::AddQuad(const Rect2<int>& region,
+                                const PackedColor& color) {
+  Quad quad = {
+    float(region.x), float(region.y), float(region.w), float(region.h), color
+  };
+  quads_.push_back(quad);
+  primitive_count_++;
+}
+
+void OpenGLRenderBatch::Submit() {
+  if (quads_.empty())
+    return;
+
+  /*
+   * Quads are not textured, unlike layers, and are blended over the target.
+   * The alpha of a layer target accumulates as coverage, so its pixels end
+   * up premultiplied as layers are composited.
+   */
+  state_.SetCapability(GL_TEXTURE_2D, false);
+  state_.SetCapability(GL_BLEND, true);
+  state_.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                   GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  if (instanced_renderer_) {
+    // Instances are read from generic attributes, not client arrays
+    state_.SetClientState(GL_VERTEX_ARRAY, false);
+    state_.SetClientState(GL_COLOR_ARRAY, false);
+    instanced_renderer_->Draw(&quads_[0], quads_.size());
+  } else {
+    SubmitVertices();
+  }
+
+  stats_.draw_calls++;
+  stats_.primitives += quads_.size();
+
+  // Keep the capacity, so next frames don't need to allocate
+  quads_.clear();
+}
+
+void OpenGLRenderBatch::set_instanced_renderer(
+    const Ptr<OpenGLInstancedRenderer>& renderer) {
+  Submit();
+  instanced_renderer_ = renderer;
+}
+
+void OpenGLRenderBatch::SubmitVertices() {
+  vertices_.resize(quads_.size() * 4);
+  auto vertex = vertices_.begin();
+  for (auto& quad : quads_) {
+    float x1 = quad.x + quad.w;
+    float y1 = quad.y + quad.h;
+    *vertex++ = { quad.x, quad.y, quad.color };
+    *vertex++ = { x1, quad.y, quad.color };
+    *vertex++ = { x1, y1, quad.color };
+    *vertex++ = { quad.x, y1, quad.color };
+  }
+
+  // Client arrays are left enabled for the next batch
+  state_.SetClientState(GL_VERTEX_ARRAY, true);
+  state_.SetClientState(GL_COLOR_ARRAY, true);
+  glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &vertices_[0].x);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &vertices_[0].color);
+  glDrawArrays(GL_QUADS, 0, GLsizei(vertices_.size()));
+  state_.InvalidateColor();
+}
+
 void OpenGLRectangle::Draw(const Rect2<int> &screen_region) const {
-  glColor4f(color_.r, color_.g, color_.b, color_.a);
-  glBegin(GL_QUADS);
-    glVertex2f(screen_region.x,
-               screen_region.y);
-    glVertex2f(screen_region.x + screen_region.w,
-               screen_region.y);
-    glVertex2f(screen_region.x + screen_region.w,
-               screen_region.y + screen_region.h);
-    glVertex2f(screen_region.x,
-               screen_region.y + screen_region.h);
-  glEnd();
+  screen_.FillRect(screen_region, color_);
 }
 
 OpenGLScreen::OpenGLScreen(const Ptr<OpenGLContext>& ctx)
-  : ctx_(ctx), shape_factory_(new OpenGLShapeFactory()) {
+  : ctx_(ctx), state_(new OpenGLStateCache(*ctx)), batch_(*state_),
+    shape_factory_(new OpenGLShapeFactory(*this)),
+    clip_(Vector2<int>(0, 0), ctx->size()),
+    fbo_(OpenGLFramebufferFunctions::Load(*ctx)),
+    instanced_renderer_(OpenGLInstancedRenderer::Load(*ctx)),
+    target_(nullptr), target_region_(Vector2<int>(0, 0), ctx->size()) {
   Init2DState();
+  batch_.set_instanced_renderer(instanced_renderer_);
+}
+
+OpenGLScreen::~OpenGLScreen() {
+  // Layers must release their GL objects while the context is alive
+  layer_cache().Clear();
 }
 
 Vector2<int> OpenGLScreen::size() const {
   return ctx_->size();
 }
 
+void OpenGLScreen::set_clip(const Rect2<int>& region) {
+  clip_ = region.Intersection(Rect2<int>(Vector2<int>(0, 0), ctx_->size()));
+  auto& target = target_region_;
+  auto area = clip_.Intersection(target);
+
+  // Scissor box is relative to the target, origin at bottom-left
+  bool scissor = area != target;
+  Rect2<int> box(area.x - target.x, target.y + target.h - area.y - area.h,
+                 area.w, area.h);
+
+  // Pending primitives were drawn under the previous scissor box, if any
+  if (!state_->HasScissor(scissor, box))
+    batch_.Submit();
+  state_->SetCapability(GL_SCISSOR_TEST, scissor);
+  if (scissor)
+    state_->Scissor(box);
+}
+
 void OpenGLScreen::Clear() {
-  glClearColor(0.0f, 0.0f, 0.0, 1.0f);
+  // Primitives drawn before clearing must be rendered in order
+  batch_.Submit();
+  state_->ClearColor(PackedColor(0, 0, 0, 255));
   glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void OpenGLScreen::Flush() {
+  batch_.Submit();
   glFlush();
   ctx_->SwapBuffers();
 }
 
+const OpenGLScreen::StateStats& OpenGLScreen::state_stats() const {
+  return state_->stats();
+}
+
+void OpenGLScreen::ResetStateStats() {
+  state_->ResetStats();
+}
+
+void OpenGLScreen::InvalidateState() {
+  batch_.Submit();
+  state_->Invalidate();
+}
+
+Ptr<Layer> OpenGLScreen::CreateLayer(const Vector2<int>& size) {
+  if (!fbo_ || size.x <= 0 || size.y <= 0)
+    return nullptr;
+
+  // Any OpenGL version supports textures of power of two sizes
+  Vector2<int> texture_size(NextPowerOfTwo(size.x), NextPowerOfTwo(size.y));
+  batch_.Submit();
+  GLuint texture, framebuffer;
+  glGenTextures(1, &texture);
+  state_->BindTexture(texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texture_size.x, texture_size.y,
+               0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  fbo_->gen(1, &framebuffer);
+  Ptr<Layer> layer(
+      new OpenGLLayer(fbo_, state_, size, texture_size, texture, framebuffer));
+
+  state_->BindFramebuffer(*fbo_, framebuffer);
+  fbo_->texture_2d(OpenGLFramebufferFunctions::kFramebuffer,
+                   OpenGLFramebufferFunctions::kColorAttachment0,
+                   GL_TEXTURE_2D, texture, 0);
+  bool complete = fbo_->check_status(OpenGLFramebufferFunctions::kFramebuffer)
+      == OpenGLFramebufferFunctions::kFramebufferComplete;
+  if (complete) {
+    state_->SetCapability(GL_SCISSOR_TEST, false);
+    state_->ClearColor(PackedColor(0, 0, 0, 0));
+    glClear(GL_COLOR_BUFFER_BIT);
+  }
+
+  // Restore the frame buffer being drawn and its clip region
+  state_->BindFramebuffer(*fbo_, target_ ?
+      static_cast<OpenGLLayer*>(target_)->framebuffer : 0);
+  set_clip(clip_);
+  return complete ? layer : nullptr;
+}
+
+std::size_t OpenGLScreen::LayerMemorySize(const Vector2<int>& size) const {
+  return std::size_t(NextPowerOfTwo(size.x)) * NextPowerOfTwo(size.y) * 4;
+}
+
+void OpenGLScreen::DrawLayer(const Layer& layer, const Vector2<int>& pos) {
+  auto& gl_layer = static_cast<const OpenGLLayer&>(layer);
+  batch_.Submit();
+
+  auto size = layer.size();
+  float s = float(size.x) / gl_layer.texture_size.x;
+  float t = float(size.y) / gl_layer.texture_size.y;
+  float x0 = float(pos.x);
+  float y0 = float(pos.y);
+  float x1 = float(pos.x + size.x);
+  float y1 = float(pos.y + size.y);
+
+  // Texturing is left enabled for the next layer, batches disable it
+  state_->SetCapability(GL_TEXTURE_2D, true);
+  state_->BindTexture(gl_layer.texture);
+
+  // Layer pixels are premultiplied, composite them over the target as such
+  state_->SetCapability(GL_BLEND, true);
+  state_->BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  state_->Color(PackedColor(255, 255, 255, 255));
+
+  // Texture rows go bottom-up, so its top is at the height of the layer
+  glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, t);
+    glVertex2f(x0, y0);
+    glTexCoord2f(s, t);
+    glVertex2f(x1, y0);
+    glTexCoord2f(s, 0.0f);
+    glVertex2f(x1, y1);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2f(x0, y1);
+  glEnd();
+}
+
+void OpenGLScreen::set_instancing(bool enabled) {
+  batch_.set_instanced_renderer(
+      enabled ? instanced_renderer_ : Ptr<OpenGLInstancedRenderer>());
+}
+
+void OpenGLScreen::SetTarget(Layer* layer, const Vector2<int>& origin) {
+  batch_.Submit();
+  target_ = layer;
+  if (layer) {
+    state_->BindFramebuffer(*fbo_,
+                            static_cast<OpenGLLayer*>(layer)->framebuffer);
+    target_region_ = Rect2<int>(origin, layer->size());
+  } else {
+    if (fbo_)
+      state_->BindFramebuffer(*fbo_, 0);
+    target_region_ = Rect2<int>(Vector2<int>(0, 0), ctx_->size());
+  }
+  SetProjection(target_region_);
+}
+
 void OpenGLScreen::Init2DState() {
-  // Set blending for considering alpha channel
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  // Blending is set by each drawing operation, as fills and layers differ
   glDepthFunc(GL_LEQUAL);
 
-  // Set projection properties
-  auto screen_size = ctx_->size();
-  glViewport(0, 0, screen_size.x, screen_size.y);
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  glOrtho(0.0,
-         GLdouble(screen_size.x),
-         GLdouble(screen_size.y),
-         0.0,
-         0.0,
-         1.0);
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
+  SetProjection(target_region_);
+}
+
+void OpenGLScreen::SetProjection(const Rect2<int>& region) {
+  // Map the region to the whole viewport, with the origin at the top-left
+  state_->Viewport(Rect2<int>(0, 0, region.w, region.h));
+  state_->Projection(region);
 }
 
 }} // namespace grog::ui
@@ -38,6 +38,10 @@ void SDLOpenGLContext::SwapBuffers() {
   SDL_GL_SwapBuffers();
 }
 
+void* SDLOpenGLContext::GetProcAddress(const char* name) {
+  return SDL_GL_GetProcAddress(name);
+}
+
 void SDLOpenGLContext::InitScreen(
     const OpenGLContextParams& params) throw (SDLInitError) {
   if (SDL_Init(SDL_INIT_VIDEO) != 0) {
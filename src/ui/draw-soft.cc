@@ -0,0 +1,133 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "grog/ui/draw-soft.h"
+
+#include "grog/ui/pixel.h"
+
+namespace grog { namespace ui {
+
+namespace {
+
+class SoftwareLayer : public Layer {
+public:
+
+  inline SoftwareLayer(const Vector2<int>& size)
+    : Layer(size, size.x * size.y * sizeof(UInt32)),
+      pixels(size.x * size.y, PackPixel(0, 0, 0, 0)) {}
+
+  std::vector<UInt32> pixels;
+};
+
+/*
+ * Composite a span of premultiplied pixels over dst with the source over
+ * operator. Unlike the pixel kernels, it has a different source for each
+ * pixel, hence it is a plain scalar loop.
+ */
+void CompositeSpan(UInt32* dst, const UInt32* src, std::size_t len) {
+  for (std::size_t i = 0; i < len; i++) {
+    auto s = reinterpret_cast<const UInt8*>(src + i);
+    UInt32 inv_alpha = 255 - s[3];
+    if (inv_alpha == 0) {
+      dst[i] = src[i];
+    } else if (inv_alpha < 255) {
+      auto d = reinterpret_cast<UInt8*>(dst + i);
+      for (int c = 0; c < 4; c++) {
+        UInt32 value = d[c] * inv_alpha + 128;
+        d[c] = UInt8(s[c] + ((value + (value >> 8)) >> 8));
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
+void SoftwareRectangle::Draw(const Rect2<int>& screen_region) const {
+  screen_.FillRect(screen_region, color_);
+}
+
+SoftwareScreen::SoftwareScreen(const Vector2<int>& size)
+  : size_(size), clip_(Vector2<int>(0, 0), size),
+    back_buffer_(size.x * size.y, PackPixel(0, 0, 0, 255)),
+    front_buffer_(back_buffer_), frame_count_(0), primitive_count_(0),
+    shape_factory_(*this), target_(back_buffer_.data()),
+    target_region_(Vector2<int>(0, 0), size) {}
+
+void SoftwareScreen::set_clip(const Rect2<int>& region) {
+  clip_ = region.Intersection(Rect2<int>(Vector2<int>(0, 0), size_));
+}
+
+void SoftwareScreen::Clear() {
+  RenderFill(clip_, PackedColor(0, 0, 0, 255));
+}
+
+void SoftwareScreen::Flush() {
+  // Unlike a swap, copying keeps the back buffer contents as they were
+  front_buffer_ = back_buffer_;
+  frame_count_++;
+}
+
+void SoftwareScreen::RenderFill(const Rect2<int>& region,
+                                const PackedColor& color) {
+  primitive_count_++;
+  // A screen of zero size has no pixels to draw on
+  auto area = region.Intersection(clip_).Intersection(target_region_);
+  if (target_region_.empty() || area.empty())
+    return;
+
+  auto& kernels = PixelKernels::Best();
+  auto span = color.opaque() ? kernels.fill_span : kernels.blend_span;
+  auto& target = target_region_;
+  for (int y = area.y; y < area.y + area.h; y++) {
+    span(&target_[(y - target.y) * target.w + area.x - target.x],
+         area.w, color.value);
+  }
+}
+
+Ptr<Layer> SoftwareScreen::CreateLayer(const Vector2<int>& size) {
+  if (size.x <= 0 || size.y <= 0)
+    return nullptr;
+  return Ptr<Layer>(new SoftwareLayer(size));
+}
+
+void SoftwareScreen::DrawLayer(const Layer& layer, const Vector2<int>& pos) {
+  auto& pixels = static_cast<const SoftwareLayer&>(layer).pixels;
+  auto size = layer.size();
+  auto area = Rect2<int>(pos, size).Intersection(clip_)
+      .Intersection(target_region_);
+  if (target_region_.empty() || area.empty())
+    return;
+
+  auto& target = target_region_;
+  for (int y = area.y; y < area.y + area.h; y++) {
+    CompositeSpan(&target_[(y - target.y) * target.w + area.x - target.x],
+                  &pixels[(y - pos.y) * size.x + area.x - pos.x], area.w);
+  }
+}
+
+void SoftwareScreen::SetTarget(Layer* layer, const Vector2<int>& origin) {
+  if (layer) {
+    target_ = static_cast<SoftwareLayer*>(layer)->pixels.data();
+    target_region_ = Rect2<int>(origin, layer->size());
+  } else {
+    target_ = back_buffer_.data();
+    target_region_ = Rect2<int>(Vector2<int>(0, 0), size_);
+  }
+}
+
+}} // namespace grog::ui
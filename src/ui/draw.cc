@@ -20,5 +20,97 @@
 
 namespace grog { namespace ui {
 
+Ptr<Layer> LayerCache::Find(const void* owner) {
+  auto entry = index_.find(owner);
+  if (entry == index_.end()) {
+    stats_.misses++;
+    return nullptr;
+  }
+  stats_.hits++;
+  layers_.splice(layers_.begin(), layers_, entry->second);
+  return entry->second->second;
+}
+
+Ptr<Layer> LayerCache::Create(const void* owner, const Vector2<int>& size) {
+  Release(owner);
+  if (screen_.LayerMemorySize(size) > budget_)
+    return nullptr;
+
+  auto layer = screen_.CreateLayer(size);
+  if (!layer || layer->memory_size() > budget_)
+    return nullptr;
+
+  Evict(layer->memory_size());
+  layers_.push_front(std::make_pair(owner, layer));
+  index_[owner] = layers_.begin();
+  memory_usage_ += layer->memory_size();
+  return layer;
+}
+
+void LayerCache::Release(const void* owner) {
+  auto entry = index_.find(owner);
+  if (entry != index_.end()) {
+    memory_usage_ -= entry->second->second->memory_size();
+    layers_.erase(entry->second);
+    index_.erase(entry);
+  }
+}
+
+void LayerCache::Clear() {
+  layers_.clear();
+  index_.clear();
+  memory_usage_ = 0;
+}
+
+void LayerCache::set_budget(std::size_t budget) {
+  budget_ = budget;
+  Evict(0);
+}
+
+void LayerCache::Evict(std::size_t memory) {
+  while (!layers_.empty() && memory_usage_ + memory > budget_) {
+    auto& victim = layers_.back();
+    memory_usage_ -= victim.second->memory_size();
+    index_.erase(victim.first);
+    layers_.pop_back();
+    stats_.evictions++;
+  }
+}
+
+void Screen::BeginRecording(DrawCommandList& list, const Rect2<int>& region) {
+  Recording rec = { &list, region, clip() };
+  recordings_.push_back(rec);
+  set_clip(region);
+}
+
+void Screen::EndRecording() {
+  auto clip = recordings_.back().clip;
+  recordings_.pop_back();
+  set_clip(clip);
+}
+
+void Screen::BeginLayer(Layer& layer, const Rect2<int>& region) {
+  Target target = { &layer, region, clip() };
+  targets_.push_back(target);
+  SetTarget(&layer, region.position());
+  set_clip(region);
+}
+
+void Screen::EndLayer() {
+  auto clip = targets_.back().clip;
+  targets_.pop_back();
+  if (targets_.empty())
+    SetTarget(nullptr, Vector2<int>(0, 0));
+  else
+    SetTarget(targets_.back().layer, targets_.back().region.position());
+  set_clip(clip);
+}
+
+void Screen::Replay(const DrawCommandList& list, const Vector2<int>& pos) {
+  for (auto& fill : list.fills()) {
+    FillRect(Rect2<int>(pos.x + fill.region.x, pos.y + fill.region.y,
+                        fill.region.w, fill.region.h), fill.color);
+  }
+}
 
 }} // namespace grog::ui
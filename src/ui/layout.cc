@@ -16,10 +16,16 @@
  * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
 #include <boost/range/adaptors.hpp>
 
 #include "grog/ui/layout.h"
 #include "grog/ui/widget.h"
+#include "grog/util/profile.h"
 
 using namespace std::placeholders;
 
@@ -46,10 +52,38 @@ void Layout::Find(const WidgetPlacement::Predicate& predicate,
 }
 
 
-Option<Widget> Layout::FindWidget(const WidgetPlacement::Predicate& predicate) {
+void Layout::ForEach(const WidgetPlacement::Action& action) {
+  // A predicate that never matches visits every child
+  Find([&action](const WidgetPlacement& child) {
+    action(child);
+    return false;
+  });
+}
+
+Option<Widget&> Layout::FindWidget(
+    const WidgetPlacement::Predicate& predicate) {
   auto child = Find(predicate);
   return child ?
-        Option<Widget>::Some(child.value().widget) : Option<Widget>::None();
+        Option<Widget&>::Some(*child.value().widget) : Option<Widget&>::None();
+}
+
+Option<const Layout::WidgetPlacement&> Layout::FindAt(
+    const Vector2<int>& pos) {
+  return Find(OnPosition(pos));
+}
+
+void Layout::FindAt(const Vector2<int>& pos,
+                    const WidgetPlacement::Action& action) {
+  auto child = FindAt(pos);
+  if (child) {
+    action(child.value());
+  }
+}
+
+Option<Widget&> Layout::FindWidgetAt(const Vector2<int>& pos) {
+  auto child = FindAt(pos);
+  return child ?
+        Option<Widget&>::Some(*child.value().widget) : Option<Widget&>::None();
 }
 
 FixedLayout::FixedLayout(const Ptr<ApplicationContext>& ctx)
@@ -62,57 +96,181 @@ FixedLayout::FixedLayout(const Ptr<ApplicationContext>& ctx)
               new DragAndDropResponder(
                   std::bind(&FixedLayout::OnDrag, this, _1, _2, _3),
                   std::bind(&FixedLayout::OnDrop, this, _1, _2, _3))))
-      .Build()) {}
+      .Build()),
+    front_depth_(0), back_depth_(0), screen_region_(0, 0, 0, 0),
+    drawn_(false), occlusion_culling_(false) {}
+
+FixedLayout::~FixedLayout() {
+  // Children may outlive the layout
+  for (auto& child : children_)
+    child.widget->ClearParent(this);
+}
 
 
 void FixedLayout::Draw(const Rect2<int>& screen_region) const {
-  for (auto& child : boost::adaptors::reverse(children_)) {
-    child.widget->Draw(screen_region.subrectangle(child.location));
+  GROG_PROFILE_SCOPE("FixedLayout::Draw");
+  screen_region_ = screen_region;
+  drawn_ = true;
+
+  // Children out of the clip region would not change any pixel
+  auto clip = screen().clip();
+  Rect2<int> region(clip.x - screen_region.x, clip.y - screen_region.y,
+                    clip.w, clip.h);
+  CollectVisible(region);
+  cull_stats_.offscreen += children_.size() - visible_.size();
+  if (occlusion_culling_)
+    CullOccluded(region);
+
+  for (auto child : visible_) {
+    if (child) {
+      child->widget->Render(screen_region.subrectangle(child->location));
+      cull_stats_.drawn++;
+    }
+  }
+}
+
+void FixedLayout::CollectVisible(const Rect2<int>& region) const {
+  visible_.clear();
+
+  // Scanning is cheaper than querying the index for many more cells
+  if (index_.CellCount(region) > long(children_.size())) {
+    for (auto& child : boost::adaptors::reverse(children_)) {
+      if (child.location.Intersects(region))
+        visible_.push_back(&child);
+    }
+    return;
+  }
+
+  candidates_.clear();
+  index_.ForEachCandidate(region, [this](const IndexEntry& entry) {
+    candidates_.push_back(entry);
+  });
+
+  // Depths are unique, and sorting by them gives the back-to-front order
+  auto by_depth = [](const IndexEntry& a, const IndexEntry& b) {
+    return a.depth < b.depth;
+  };
+  std::sort(candidates_.begin(), candidates_.end(), by_depth);
+  candidates_.erase(
+      std::unique(candidates_.begin(), candidates_.end()), candidates_.end());
+  for (auto& entry : candidates_) {
+    if (entry.child->location.Intersects(region))
+      visible_.push_back(&*entry.child);
   }
 }
 
-Option<Layout::WidgetPlacement> FixedLayout::Find(
+void FixedLayout::CullOccluded(const Rect2<int>& region) const {
+  // Bound the cost of each check when many opaque children overlap
+  static const std::size_t kMaxOccluders = 32;
+
+  occluders_.clear();
+  for (auto& child : boost::adaptors::reverse(visible_)) {
+    auto visible_region = child->location.Intersection(region);
+    auto covers = [&visible_region](const Rect2<int>& occluder) {
+      return occluder.Contains(visible_region);
+    };
+    if (std::any_of(occluders_.begin(), occluders_.end(), covers)) {
+      child = nullptr;
+      cull_stats_.occluded++;
+    } else if (child->widget->opaque() &&
+               occluders_.size() < kMaxOccluders) {
+      occluders_.push_back(visible_region);
+    }
+  }
+}
+
+Option<const Layout::WidgetPlacement&> FixedLayout::Find(
     const WidgetPlacement::Predicate& predicate) {
   for (auto& child : children_) {
     if (predicate(child))
-      return Option<WidgetPlacement>::Some(new WidgetPlacement(child));
+      return Option<const WidgetPlacement&>::Some(child);
   }
-  return Option<WidgetPlacement>::None();
+  return Option<const WidgetPlacement&>::None();
+}
+
+void FixedLayout::ForEach(const WidgetPlacement::Action& action) {
+  for (auto& child : children_)
+    action(child);
+}
+
+Option<const Layout::WidgetPlacement&> FixedLayout::FindAt(
+    const Vector2<int>& pos) {
+  const IndexEntry* found = nullptr;
+  index_.ForEachCandidate(pos, [&pos, &found](const IndexEntry& entry) {
+    if ((!found || entry.depth > found->depth) &&
+        entry.child->location.Wrap(pos))
+      found = &entry;
+  });
+  return found ?
+      Option<const WidgetPlacement&>::Some(*found->child) :
+      Option<const WidgetPlacement&>::None();
 }
 
 FixedLayout& FixedLayout::AddWidget(const Ptr<Widget>& widget,
                                     const Rect2<int>& region) {
+  auto old = EntryOf(widget);
+  if (old) {
+    auto location = old->child->location;
+    index_.Remove(*old, location);
+    children_.erase(old->child);
+    entries_.erase(widget.get());
+    PostRedisplayChild(location);
+  }
+
   WidgetPlacement p = { widget, region };
   children_.push_back(p);
-  PostRedisplay();
+  widget->set_parent(this);
+  IndexEntry entry = { std::prev(children_.end()), --back_depth_ };
+  entries_[widget.get()] = entry;
+  index_.Insert(entry, region);
+  PostRedisplayChild(region);
   return *this;
 }
 
 void FixedLayout::MoveWidget(const Ptr<Widget>& widget,
                              const Vector2<int>& to) {
-  for (auto& child : children_) {
-    if (child.widget == widget) {
-      child.location.set_position(to);
-      PostRedisplay();
-    }
+  auto entry = EntryOf(widget);
+  if (entry) {
+    auto& location = entry->child->location;
+    index_.Remove(*entry, location);
+    PostRedisplayChild(location);
+    location.set_position(to);
+    PostRedisplayChild(location);
+    index_.Insert(*entry, location);
   }
 }
 
 void FixedLayout::BringToFront(const Ptr<Widget>& widget) {
-  for (auto child : children_) {
-    if (child.widget == widget) {
-      children_.remove_if([&widget](
-          const WidgetPlacement& e) { return e.widget == widget; });
-      children_.push_front(child);
-      PostRedisplay();
-    }
+  auto entry = EntryOf(widget);
+  if (entry) {
+    auto& location = entry->child->location;
+    index_.Remove(*entry, location);
+    children_.splice(children_.begin(), children_, entry->child);
+    entry->depth = ++front_depth_;
+    index_.Insert(*entry, location);
+    PostRedisplayChild(location);
   }
 }
 
+FixedLayout::IndexEntry* FixedLayout::EntryOf(const Ptr<Widget>& widget) {
+  auto entry = entries_.find(widget.get());
+  return entry == entries_.end() ? nullptr : &entry->second;
+}
+
+void FixedLayout::PostRedisplayChild(const Rect2<int>& location) {
+  Invalidate();
+
+  // Until drawn, the layout position on the screen is unknown
+  if (drawn_)
+    PostRedisplay(screen_region_.subrectangle(location));
+  else
+    PostRedisplay();
+}
+
 void FixedLayout::OnDrag(const Widget& widget,
                          const Vector2<int>& pos,
                          const Vector2<int>& mov) {  
-  Layout::Find(OnPosition(pos), [this, &mov](const WidgetPlacement& child) {
+  Layout::FindAt(pos, [this, &mov](const WidgetPlacement& child) {
     if (!child.widget->locked()) {
       MoveWidget(child.widget, child.location.position() + mov);
       BringToFront(child.widget);
@@ -126,4 +284,179 @@ void FixedLayout::OnDrop(const Widget& widget,
   // Move is done on drag, just ignore
 }
 
+ScrollLayout::ScrollLayout(const RowFactory& factory,
+                           std::size_t row_count,
+                           int row_height,
+                           const Ptr<ApplicationContext>& ctx)
+  : Layout(ctx), DelegatedMouseResponder(
+      new DelegatedContextAwareMouseResponder<Layout>(
+          [this]() -> Layout& { return *this; },
+          new LayoutResponder())),
+    factory_(factory), row_count_(row_count),
+    row_height_(std::max(row_height, 1)),
+    offset_(0), first_row_(0), viewport_(0, 0), screen_region_(0, 0, 0, 0),
+    drawn_(false) {}
+
+ScrollLayout::~ScrollLayout() {
+  // The factory may keep the row widgets
+  ReleaseRows();
+}
+
+void ScrollLayout::Draw(const Rect2<int>& screen_region) const {
+  GROG_PROFILE_SCOPE("ScrollLayout::Draw");
+  screen_region_ = screen_region;
+  drawn_ = true;
+  auto size = Vector2<int>(screen_region.w, screen_region.h);
+  if (size.x != viewport_.x || size.y != viewport_.y) {
+    viewport_ = size;
+    Materialize();
+  }
+
+  auto clip = screen().clip();
+  for (auto& row : rows_) {
+    auto row_region = screen_region.subrectangle(row.location);
+    if (row_region.Intersects(clip))
+      row.widget->Render(row_region);
+  }
+}
+
+bool ScrollLayout::Respond(const MouseButtonEvent& ev) {
+  if (ev.state == kMouseButtonPressed) {
+    if (ev.button == kWheelUpMouseButton) {
+      ScrollBy(-long(ev.clicks) * row_height_);
+      return true;
+    }
+    if (ev.button == kWheelDownMouseButton) {
+      ScrollBy(long(ev.clicks) * row_height_);
+      return true;
+    }
+  }
+  return DelegatedMouseResponder::Respond(ev);
+}
+
+bool ScrollLayout::Respond(const MouseMotionEvent& ev) {
+  return DelegatedMouseResponder::Respond(ev);
+}
+
+Option<const Layout::WidgetPlacement&> ScrollLayout::Find(
+    const WidgetPlacement::Predicate& predicate) {
+  for (auto& row : rows_) {
+    if (predicate(row))
+      return Option<const WidgetPlacement&>::Some(row);
+  }
+  return Option<const WidgetPlacement&>::None();
+}
+
+void ScrollLayout::ForEach(const WidgetPlacement::Action& action) {
+  for (auto& row : rows_)
+    action(row);
+}
+
+Option<const Layout::WidgetPlacement&> ScrollLayout::FindAt(
+    const Vector2<int>& pos) {
+  if (pos.y >= 0 && !rows_.empty()) {
+    auto row = std::size_t((offset_ + pos.y) / row_height_);
+    if (row >= first_row_ && row - first_row_ < rows_.size()) {
+      auto& child = rows_[row - first_row_];
+      if (child.location.Wrap(pos))
+        return Option<const WidgetPlacement&>::Some(child);
+    }
+  }
+  return Option<const WidgetPlacement&>::None();
+}
+
+void ScrollLayout::set_row_count(std::size_t count) {
+  row_count_ = count;
+  offset_ = std::min(offset_, max_offset());
+  Materialize();
+  PostRedisplayViewport();
+}
+
+void ScrollLayout::ScrollTo(long offset) {
+  offset = std::max(0L, std::min(offset, max_offset()));
+  if (offset != offset_) {
+    offset_ = offset;
+    Materialize();
+    PostRedisplayViewport();
+  }
+}
+
+void ScrollLayout::InvalidateRows() {
+  ReleaseRows();
+  rows_.clear();
+  Materialize();
+  PostRedisplayViewport();
+}
+
+long ScrollLayout::max_offset() const {
+  return std::max(0L, long(row_count_) * row_height_ - viewport_.y);
+}
+
+void ScrollLayout::Materialize() const {
+  std::size_t first = 0, last = 0;
+  if (viewport_.y > 0) {
+    first = std::min(row_count_, std::size_t(offset_ / row_height_));
+    last = std::min(row_count_, std::size_t(
+        (offset_ + viewport_.y + row_height_ - 1) / row_height_));
+  }
+
+  // Rows still in sight keep their widgets, and their parent
+  ReleaseRows();
+  scratch_rows_.clear();
+  for (auto row = first; row < last; row++) {
+    auto kept = row - first_row_;
+    auto widget = row >= first_row_ && kept < rows_.size() ?
+        rows_[kept].widget : factory_(row);
+    widget->set_parent(this);
+    WidgetPlacement p = { widget, Rect2<int>(
+        0, int(long(row) * row_height_ - offset_), viewport_.x, row_height_) };
+    scratch_rows_.push_back(p);
+  }
+  rows_.swap(scratch_rows_);
+  scratch_rows_.clear();
+  first_row_ = first;
+}
+
+void ScrollLayout::ReleaseRows() const {
+  for (auto& row : rows_)
+    row.widget->ClearParent(this);
+}
+
+void ScrollLayout::PostRedisplayViewport() {
+  Invalidate();
+
+  // Until drawn, the layout position on the screen is unknown
+  if (drawn_)
+    PostRedisplay(screen_region_);
+  else
+    PostRedisplay();
+}
+
+void DrawCostOverlay::Draw(const Rect2<int>& screen_region) const {
+  WrapperWidget::Draw(screen_region);
+  if (!draw_stats_enabled())
+    return;
+
+  // Shares are taken over every child, but only the ones in sight shaded
+  costs_.clear();
+  double total = 0.0;
+  layout_->ForEach([&](const Layout::WidgetPlacement& child) {
+    double cost = child.widget->draw_stats().draw_time.count();
+    total += cost;
+    auto region = screen_region.subrectangle(child.location);
+    if (region.Intersects(screen_region))
+      costs_.push_back(std::make_pair(region, cost));
+  });
+  if (total <= 0.0)
+    return;
+
+  // Heat is translucent, so the children stay visible below
+  auto& scr = screen();
+  for (auto& cost : costs_) {
+    float share = float(cost.second / total);
+    Color heat = { share, 0.0f, 1.0f - share, 0.25f + 0.5f * share };
+    scr.FillRect(cost.first, heat);
+  }
+}
+
 }} // namespace grog::ui
@@ -22,6 +22,8 @@
   #include <Windows.h>
 #endif
 
+#include <iostream>
+
 #include "grog/ui/app.h"
 
 namespace {
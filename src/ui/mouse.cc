@@ -19,24 +19,29 @@
 #include "grog/ui/layout.h"
 #include "grog/ui/mouse.h"
 #include "grog/ui/widget.h"
+#include "grog/util/profile.h"
 
 namespace grog { namespace ui {
 
 bool LayoutResponder::Respond(Layout& layout, const MouseButtonEvent &ev) {
-  auto child = layout.Find(Layout::OnPosition(ev.pos));
+  GROG_PROFILE_SCOPE("LayoutResponder::Respond");
+  auto child = layout.FindAt(ev.pos);
   if (child) {
     auto& c = child.value();
-    MouseButtonEvent new_ev(ev.button, ev.state, ev.pos - c.location.position());
+    MouseButtonEvent new_ev(ev.button, ev.state,
+                            ev.pos - c.location.position(), ev.clicks, ev.time);
     return c.widget->Respond(new_ev);
   }
   return false;
 }
 
 bool LayoutResponder::Respond(Layout& layout, const MouseMotionEvent &ev) {
-  auto child = layout.Find(Layout::OnPosition(ev.abs_pos));
+  GROG_PROFILE_SCOPE("LayoutResponder::Respond");
+  auto child = layout.FindAt(ev.abs_pos);
   if (child) {
     auto& c = child.value();
-    MouseMotionEvent new_ev(ev.abs_pos - c.location.position(), ev.rel_pos);
+    MouseMotionEvent new_ev(
+        ev.abs_pos - c.location.position(), ev.rel_pos, ev.time);
     return c.widget->Respond(new_ev);
   }
   return false;
@@ -66,20 +71,21 @@ bool DragAndDropResponder::Respond(Layout& layout, const MouseButtonEvent &ev) {
   if (ev.button != kLeftMouseButton)
     return false;
   if (ev.state == kMouseButtonPressed) {
-    draging_ = layout.FindWidget(Layout::OnPosition(ev.pos));
-    return draging_.valid();
+    auto child = layout.FindAt(ev.pos);
+    draging_ = child ? child.value().widget : nullptr;
+    return bool(draging_);
   } else { // button released
-    if (draging_.valid()) {
-      on_drop_(draging_.value(), draging_from_, ev.pos);
+    if (draging_) {
+      on_drop_(*draging_, draging_from_, ev.pos);
     }
-    draging_ = Option<Widget>::None();
+    draging_ = nullptr;
     return true;
   }
 }
 
 bool DragAndDropResponder::Respond(Layout& layout, const MouseMotionEvent &ev) {
   if (draging_) {
-    on_drag_(draging_.value(), ev.abs_pos - ev.rel_pos, ev.rel_pos);
+    on_drag_(*draging_, ev.abs_pos - ev.rel_pos, ev.rel_pos);
     return true;
   }
   return false;
@@ -0,0 +1,204 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "grog/ui/pixel.h"
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (GROG_COMPILER == GROG_COMPILER_GCC || \
+     GROG_COMPILER == GROG_COMPILER_CLANG)
+  #define GROG_PIXEL_KERNELS_X86
+  #include <immintrin.h>
+#endif
+
+namespace grog { namespace ui {
+
+namespace {
+
+/*
+ * Divide a value in [0, 255 * 255] by 255, rounding to nearest, without
+ * an actual division. Vector kernels use the very same arithmetic, so every
+ * instruction set blends to the same bytes.
+ */
+inline UInt32 Div255(UInt32 value) {
+  value += 128;
+  return (value + (value >> 8)) >> 8;
+}
+
+/*
+ * Obtain the source terms of the blend equation, i.e., each channel of the
+ * pixel multiplied by its alpha, in memory order. The alpha channel blends
+ * as a fully saturated source.
+ */
+inline void SourceTerms(UInt32 pixel, UInt16 terms[4], UInt16& inv_alpha) {
+  auto src = reinterpret_cast<const UInt8*>(&pixel);
+  UInt32 alpha = src[3];
+  terms[0] = UInt16(src[0] * alpha);
+  terms[1] = UInt16(src[1] * alpha);
+  terms[2] = UInt16(src[2] * alpha);
+  terms[3] = UInt16(255 * alpha);
+  inv_alpha = UInt16(255 - alpha);
+}
+
+void ScalarFillSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  std::fill(dst, dst + len, pixel);
+}
+
+void ScalarBlendSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  UInt16 terms[4], inv_alpha;
+  SourceTerms(pixel, terms, inv_alpha);
+  auto bytes = reinterpret_cast<UInt8*>(dst);
+  for (std::size_t i = 0; i < len * 4; i += 4) {
+    bytes[i + 0] = UInt8(Div255(terms[0] + bytes[i + 0] * inv_alpha));
+    bytes[i + 1] = UInt8(Div255(terms[1] + bytes[i + 1] * inv_alpha));
+    bytes[i + 2] = UInt8(Div255(terms[2] + bytes[i + 2] * inv_alpha));
+    bytes[i + 3] = UInt8(Div255(terms[3] + bytes[i + 3] * inv_alpha));
+  }
+}
+
+#ifdef GROG_PIXEL_KERNELS_X86
+
+__attribute__((target("sse2")))
+inline __m128i BlendPixels(
+    __m128i dst, __m128i terms, __m128i inv_alpha, __m128i bias) {
+  auto zero = _mm_setzero_si128();
+  auto lo = _mm_unpacklo_epi8(dst, zero);
+  auto hi = _mm_unpackhi_epi8(dst, zero);
+  lo = _mm_add_epi16(_mm_add_epi16(
+      _mm_mullo_epi16(lo, inv_alpha), terms), bias);
+  hi = _mm_add_epi16(_mm_add_epi16(
+      _mm_mullo_epi16(hi, inv_alpha), terms), bias);
+  lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+  hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+  return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__((target("sse2")))
+void SSE2FillSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  auto pixels = _mm_set1_epi32(Int32(pixel));
+  std::size_t i = 0;
+  for (; i + 4 <= len; i += 4)
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pixels);
+  ScalarFillSpan(dst + i, len - i, pixel);
+}
+
+__attribute__((target("sse2")))
+void SSE2BlendSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  UInt16 t[4], inv_alpha;
+  SourceTerms(pixel, t, inv_alpha);
+  auto terms = _mm_setr_epi16(t[0], t[1], t[2], t[3], t[0], t[1], t[2], t[3]);
+  auto inv = _mm_set1_epi16(Int16(inv_alpha));
+  auto bias = _mm_set1_epi16(128);
+  std::size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    auto ptr = reinterpret_cast<__m128i*>(dst + i);
+    _mm_storeu_si128(ptr, BlendPixels(_mm_loadu_si128(ptr), terms, inv, bias));
+  }
+  ScalarBlendSpan(dst + i, len - i, pixel);
+}
+
+__attribute__((target("avx2")))
+void AVX2FillSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  auto pixels = _mm256_set1_epi32(Int32(pixel));
+  std::size_t i = 0;
+  for (; i + 8 <= len; i += 8)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pixels);
+  ScalarFillSpan(dst + i, len - i, pixel);
+}
+
+__attribute__((target("avx2")))
+void AVX2BlendSpan(UInt32* dst, std::size_t len, UInt32 pixel) {
+  UInt16 t[4], inv_alpha;
+  SourceTerms(pixel, t, inv_alpha);
+  auto terms = _mm256_setr_epi16(
+      t[0], t[1], t[2], t[3], t[0], t[1], t[2], t[3],
+      t[0], t[1], t[2], t[3], t[0], t[1], t[2], t[3]);
+  auto inv = _mm256_set1_epi16(Int16(inv_alpha));
+  auto bias = _mm256_set1_epi16(128);
+  auto zero = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    // Unpack and pack work within 128-bit lanes, so pixel order is kept
+    auto ptr = reinterpret_cast<__m256i*>(dst + i);
+    auto pixels = _mm256_loadu_si256(ptr);
+    auto lo = _mm256_unpacklo_epi8(pixels, zero);
+    auto hi = _mm256_unpackhi_epi8(pixels, zero);
+    lo = _mm256_add_epi16(_mm256_add_epi16(
+        _mm256_mullo_epi16(lo, inv), terms), bias);
+    hi = _mm256_add_epi16(_mm256_add_epi16(
+        _mm256_mullo_epi16(hi, inv), terms), bias);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+    _mm256_storeu_si256(ptr, _mm256_packus_epi16(lo, hi));
+  }
+  SSE2BlendSpan(dst + i, len - i, pixel);
+}
+
+#endif // GROG_PIXEL_KERNELS_X86
+
+const PixelKernels kScalarKernels = {
+  kScalarInstructionSet, ScalarFillSpan, ScalarBlendSpan
+};
+
+#ifdef GROG_PIXEL_KERNELS_X86
+const PixelKernels kSSE2Kernels = {
+  kSSE2InstructionSet, SSE2FillSpan, SSE2BlendSpan
+};
+
+const PixelKernels kAVX2Kernels = {
+  kAVX2InstructionSet, AVX2FillSpan, AVX2BlendSpan
+};
+#endif
+
+} // anonymous namespace
+
+const PixelKernels& PixelKernels::Best() {
+  static const PixelKernels& best = []() -> const PixelKernels& {
+    if (auto avx2 = ForInstructionSet(kAVX2InstructionSet))
+      return avx2.value();
+    if (auto sse2 = ForInstructionSet(kSSE2InstructionSet))
+      return sse2.value();
+    return kScalarKernels;
+  }();
+  return best;
+}
+
+Option<const PixelKernels&> PixelKernels::ForInstructionSet(
+    PixelInstructionSet instruction_set) {
+  typedef Option<const PixelKernels&> Result;
+  switch (instruction_set) {
+    case kScalarInstructionSet:
+      return Result::Some(kScalarKernels);
+#ifdef GROG_PIXEL_KERNELS_X86
+    case kSSE2InstructionSet:
+      if (__builtin_cpu_supports("sse2"))
+        return Result::Some(kSSE2Kernels);
+      break;
+    case kAVX2InstructionSet:
+      if (__builtin_cpu_supports("avx2"))
+        return Result::Some(kAVX2Kernels);
+      break;
+#endif
+    default:
+      break;
+  }
+  return Result::None();
+}
+
+}} // namespace grog::ui
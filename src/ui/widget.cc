@@ -23,14 +23,116 @@
 namespace grog { namespace ui {
 
 Widget::Widget(const Ptr<ApplicationContext>& app_ctx)
-  : app_ctx_(app_ctx), enabled_(true), locked_(false), visible_(true) {
+  : AbstractApplicationContextProvider(app_ctx),
+    app_ctx_(app_ctx), parent_(nullptr), enabled_(true), locked_(false),
+    visible_(true), cached_as_layer_(false), layer_valid_(false),
+    layer_region_(0, 0, 0, 0) {
   if (!app_ctx_)
     app_ctx_ = Application::instance().context();
 }
 
+Widget::~Widget() {
+  if (cached_as_layer_)
+    screen().layer_cache().Release(this);
+}
+
+bool Widget::draw_stats_enabled_ = false;
+
+void Widget::Render(const Rect2<int>& screen_region) const {
+  if (!draw_stats_enabled_) {
+    Produce(screen_region);
+    return;
+  }
+
+  auto& scr = screen();
+  auto primitives = scr.primitive_count();
+  auto start = std::chrono::steady_clock::now();
+  Produce(screen_region);
+  auto end = std::chrono::steady_clock::now();
+
+  auto& state = draw_stats_;
+  state.stats.draws++;
+  state.stats.primitives += scr.primitive_count() - primitives;
+  state.stats.draw_time += end - start;
+  if (end - state.second_start >= std::chrono::seconds(1)) {
+    // Draws older than a second ago don't tell the current rate
+    bool consecutive = end - state.second_start < std::chrono::seconds(2);
+    state.stats.draws_per_second = consecutive ? state.draws_in_second : 0;
+    state.second_start = end;
+    state.draws_in_second = 0;
+  }
+  state.draws_in_second++;
+}
+
+void Widget::set_retained(bool value) {
+  if (value && !retained_output_)
+    retained_output_ = Ptr<RetainedOutput>(new RetainedOutput());
+  else if (!value)
+    retained_output_.reset();
+}
+
+void Widget::set_cached_as_layer(bool value) {
+  if (cached_as_layer_ && !value)
+    screen().layer_cache().Release(this);
+  cached_as_layer_ = value;
+  layer_valid_ = false;
+}
+
+void Widget::Invalidate() const {
+  for (auto widget = this; widget; widget = widget->parent_) {
+    if (widget->retained_output_)
+      widget->retained_output_->valid = false;
+    widget->layer_valid_ = false;
+  }
+}
+
+void Widget::Produce(const Rect2<int>& screen_region) const {
+  if (cached_as_layer_ && ProduceLayer(screen_region))
+    return;
+
+  if (!retained_output_) {
+    Draw(screen_region);
+    return;
+  }
+
+  auto& output = *retained_output_;
+  auto& scr = screen();
+  if (!output.valid || output.region != screen_region) {
+    output.commands.Clear();
+    scr.BeginRecording(output.commands, screen_region);
+    Draw(screen_region);
+    scr.EndRecording();
+    output.region = screen_region;
+    output.valid = true;
+  }
+  scr.Replay(output.commands, screen_region.position());
+}
+
+bool Widget::ProduceLayer(const Rect2<int>& screen_region) const {
+  auto& scr = screen();
+  if (scr.recording() || screen_region.empty())
+    return false;
+
+  auto& cache = scr.layer_cache();
+  auto layer = cache.Find(this);
+  if (!layer || !layer_valid_ || layer_region_ != screen_region) {
+    layer = cache.Create(
+        this, Vector2<int>(screen_region.w, screen_region.h));
+    if (!layer)
+      return false;
+    scr.BeginLayer(*layer, screen_region);
+    Draw(screen_region);
+    scr.EndLayer();
+    layer_valid_ = true;
+    layer_region_ = screen_region;
+  }
+  scr.DrawLayer(*layer, screen_region.position());
+  return true;
+}
+
 void WrapperWidget::Draw(const Rect2<int>& screen_region) const {
   if (child_)
-    child_->Draw(screen_region);
+    child_->Render(screen_region);
 }
 
 }} // namespace grog::ui
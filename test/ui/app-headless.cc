@@ -0,0 +1,98 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include <boost/format.hpp>
+#include <grog/ui/app-headless.h>
+
+using namespace grog::ui;
+
+namespace {
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+/*
+ * Wait until given flag is set, for one second at most.
+ */
+bool WaitFor(const std::atomic<bool>& flag) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (!flag && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return flag;
+}
+
+/*
+ * Work posted from another thread must wake up the loop, which must then
+ * fire the timers it schedules and return from Run() once stopped.
+ */
+void TestPostedWorkAndTimersRun() {
+  HeadlessApplicationLoop loop;
+  std::atomic<bool> returned(false), posted(false), fired(false);
+  std::thread runner([&loop, &returned]() {
+    loop.Run();
+    returned = true;
+  });
+
+  // Let the loop block waiting for work before posting any
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto scheduled = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point fire_time;
+  loop.AddWorkUnit([&]() {
+    posted = true;
+    loop.ScheduleWorkUnit([&]() {
+      fire_time = std::chrono::steady_clock::now();
+      fired = true;
+      return false;
+    }, std::chrono::milliseconds(20));
+    return false;
+  });
+
+  if (!WaitFor(posted))
+    Fail(boost::format("work posted from another thread not run"));
+  if (!WaitFor(fired))
+    Fail(boost::format("scheduled timer not fired"));
+  else if (fire_time - scheduled < std::chrono::milliseconds(20))
+    Fail(boost::format("timer fired before its delay"));
+
+  loop.Stop();
+  if (!WaitFor(returned)) {
+    // The loop can't be destroyed while running, give up on it
+    Fail(boost::format("Run() didn't return after Stop()"));
+    runner.detach();
+    std::exit(EXIT_FAILURE);
+  } else {
+    runner.join();
+  }
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestPostedWorkAndTimersRun();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <grog/ui/app-sdl.h>
+
+#include "grog/util/platform.h" // required for platform-dependent includes
+
+#ifdef GROG_PLATFORM_IS_POSIX
+  #include <SDL/SDL.h>
+#else
+  #include <SDL.h>
+#endif
+
+using namespace grog::ui;
+
+namespace {
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+SDL_Event Motion(int x, int y, int xrel, int yrel) {
+  SDL_Event ev;
+  ev.motion.type = SDL_MOUSEMOTION;
+  ev.motion.state = 0;
+  ev.motion.x = Uint16(x);
+  ev.motion.y = Uint16(y);
+  ev.motion.xrel = Sint16(xrel);
+  ev.motion.yrel = Sint16(yrel);
+  return ev;
+}
+
+SDL_Event Button(Uint8 type, Uint8 button, int x, int y) {
+  SDL_Event ev;
+  ev.button.type = type;
+  ev.button.button = button;
+  ev.button.state = type == SDL_MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+  ev.button.x = Uint16(x);
+  ev.button.y = Uint16(y);
+  return ev;
+}
+
+SDL_Event WakeUp() {
+  SDL_Event ev;
+  ev.user.type = SDL_USEREVENT;
+  ev.user.code = SDLApplicationLoop::kWorkUnitPending;
+  return ev;
+}
+
+void TestBurstsAreFolded() {
+  SDLApplicationLoop::InputBatch batch;
+  auto& events = batch.events;
+  events.push_back(WakeUp());
+  for (int i = 1; i <= 10; i++)
+    events.push_back(Motion(i, 2 * i, 1, 2));
+  events.push_back(WakeUp());
+  for (int i = 0; i < 5; i++) {
+    events.push_back(Button(SDL_MOUSEBUTTONDOWN, SDL_BUTTON_WHEELDOWN, 7, i));
+    events.push_back(Button(SDL_MOUSEBUTTONUP, SDL_BUTTON_WHEELDOWN, 7, i));
+  }
+  events.push_back(Button(SDL_MOUSEBUTTONDOWN, SDL_BUTTON_WHEELUP, 7, 9));
+  events.push_back(Button(SDL_MOUSEBUTTONUP, SDL_BUTTON_WHEELUP, 7, 9));
+  events.push_back(Motion(20, 20, 3, 3));
+  events.push_back(Button(SDL_MOUSEBUTTONDOWN, SDL_BUTTON_LEFT, 20, 20));
+  events.push_back(WakeUp());
+
+  SDLApplicationLoop::InputStats stats;
+  SDLApplicationLoop::CoalesceInput(batch, stats);
+
+  // Wake-up, motion, wheel down x2, wheel up x2, motion, left button
+  if (events.size() != 8 || batch.clicks.size() != 8) {
+    Fail(boost::format("%d events after coalescing") % events.size());
+    return;
+  }
+  auto& motion = events[1].motion;
+  if (motion.x != 10 || motion.y != 20 || motion.xrel != 10 ||
+      motion.yrel != 20)
+    Fail(boost::format("motion folded into (%d, %d) rel (%d, %d)") %
+         motion.x % motion.y % motion.xrel % motion.yrel);
+  if (events[2].button.button != SDL_BUTTON_WHEELDOWN ||
+      events[2].type != SDL_MOUSEBUTTONDOWN ||
+      events[3].type != SDL_MOUSEBUTTONUP ||
+      batch.clicks[2] != 5 || batch.clicks[3] != 5 || events[2].button.y != 4)
+    Fail(boost::format("wheel down ticks not folded into 5 clicks"));
+  if (events[4].button.button != SDL_BUTTON_WHEELUP || batch.clicks[4] != 1)
+    Fail(boost::format("wheel up folded with wheel down"));
+  if (events[6].type != SDL_MOUSEMOTION ||
+      events[7].button.button != SDL_BUTTON_LEFT)
+    Fail(boost::format("events reordered by coalescing"));
+  if (stats.raw_events != 27 || stats.folded_motion_events != 9 ||
+      stats.folded_wheel_events != 8 || stats.folded_wakeup_events != 2)
+    Fail(boost::format("unexpected stats: %d raw, %d motion, %d wheel, "
+                       "%d wake-up") % stats.raw_events %
+         stats.folded_motion_events % stats.folded_wheel_events %
+         stats.folded_wakeup_events);
+}
+
+/*
+ * Work units exceeding the budget must make the loop yield, running the
+ * remaining ones on the next iteration, with repeating units behind them.
+ */
+void TestWorkBudgetDefersUnits() {
+  auto loop = SDLApplicationLoop::instance();
+  loop->set_work_budget(std::chrono::milliseconds(15));
+
+  std::vector<char> ran;
+  int repeats = 2;
+  auto unit = [&ran](char name, const std::function<bool()>& repeat) {
+    return [&ran, name, repeat]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ran.push_back(name);
+      return repeat();
+    };
+  };
+  auto once = []() { return false; };
+  loop->AddWorkUnit(unit('a', [&repeats]() { return --repeats > 0; }));
+  loop->AddWorkUnit(unit('b', once));
+  loop->AddWorkUnit(unit('c', once));
+  loop->AddWorkUnit(unit('d', once));
+
+  std::string passes;
+  for (int i = 0; i < 4; i++) {
+    ran.clear();
+    loop->ProcessWorkUnits();
+    passes += std::string(ran.begin(), ran.end()) + "/";
+  }
+  if (passes != "ab/cd/a//")
+    Fail(boost::format("work units run in passes %s, expected ab/cd/a//") %
+         passes);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestBurstsAreFolded();
+  TestWorkBudgetDefersUnits();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
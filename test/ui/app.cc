@@ -0,0 +1,307 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include <boost/format.hpp>
+#include <grog/ui/app.h>
+#include <grog/ui/damage.h>
+#include <grog/ui/layout.h>
+#include <grog/ui/widget.h>
+
+#include "fake.h"
+
+using namespace grog::test;
+using grog::util::NotificationChannel;
+
+namespace {
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+struct Feed : NotificationChannel::Sender {};
+
+struct Quote : NotificationChannel::Message {
+  int price;
+  inline Quote(int price) : price(price) {}
+};
+
+/*
+ * A burst of notifications posted within a frame must be delivered once,
+ * in the same work unit that draws the frame and before drawing it.
+ */
+void TestDeferredNotificationsAreCoalescedPerFrame() {
+  Ptr<FakeApplicationLoop> loop(new FakeApplicationLoop());
+  auto screen = new FakeScreen(Vector2<int>(640, 480));
+  Ptr<ApplicationContext> ctx(new DefaultApplicationContext(loop, screen));
+  Ptr<NotificationChannel> channel(new NotificationChannel());
+  ctx->DeferNotifications(channel);
+
+  int deliveries = 0, last_price = 0;
+  unsigned long frames_before_delivery = 0;
+  channel->Listen<Quote>([&](const Quote& quote) {
+    deliveries++;
+    last_price = quote.price;
+    frames_before_delivery = screen->frame_count();
+    ctx->PostRedisplay(Rect2<int>(0, 0, 10, 10));
+  });
+
+  Feed feed;
+  for (int i = 1; i <= 500; i++)
+    channel->Post(feed, Quote(i));
+  if (deliveries)
+    Fail(boost::format("notification delivered before the frame"));
+
+  auto work_units = loop->RunWorkUnits();
+  if (work_units != 1)
+    Fail(boost::format("%d work units for a single frame") % work_units);
+  if (deliveries != 1 || last_price != 500)
+    Fail(boost::format("%d deliveries, last price %d") %
+         deliveries % last_price);
+  if (frames_before_delivery != 0 || screen->frame_count() != 1)
+    Fail(boost::format("notification not delivered before drawing"));
+  if (loop->RunWorkUnits())
+    Fail(boost::format("work pending after the frame was drawn"));
+}
+
+/*
+ * A widget that requests a redisplay whenever it is clicked.
+ */
+class ClickableWidget : public Widget, public MouseUnresponder {
+public:
+
+  inline ClickableWidget(const Ptr<ApplicationContext>& ctx) : Widget(ctx) {}
+
+  inline virtual void Draw(const Rect2<int>& screen_region) const {}
+
+  inline virtual bool Respond(const MouseButtonEvent& ev) {
+    PostRedisplay(Rect2<int>(ev.pos.x, ev.pos.y, 1, 1));
+    return true;
+  }
+
+  inline virtual bool Respond(const MouseMotionEvent& ev) { return false; }
+};
+
+void TestInputLatencyIsMeasuredOnPresent() {
+  Ptr<FakeApplicationLoop> loop(new FakeApplicationLoop());
+  auto ctx = NewFakeContext(loop);
+  AbstractApplicationContextProvider ctx_prov(ctx);
+  Ptr<Window> win = new Window(ctx_prov);
+  win->set_child<ClickableWidget>(new ClickableWidget(ctx));
+  ctx->set_window(win);
+  loop->RunWorkUnits();
+  ctx->ResetInputLatency();
+
+  // Motion doesn't redisplay, so it has no latency to measure
+  auto time = std::chrono::steady_clock::now() - std::chrono::milliseconds(5);
+  loop->HandleMouseMotionEvent(MouseMotionEvent(
+      Vector2<int>(10, 10), Vector2<int>(1, 1), time));
+  loop->HandleMouseButtonEvent(MouseButtonEvent(
+      kLeftMouseButton, kMouseButtonPressed, Vector2<int>(10, 10), 1, time));
+  loop->HandleMouseButtonEvent(MouseButtonEvent(
+      kLeftMouseButton, kMouseButtonReleased, Vector2<int>(10, 10), 1,
+      time + std::chrono::milliseconds(1)));
+  loop->RunWorkUnits();
+
+  // Both clicks are presented by the same frame, the earliest one counts
+  auto& latency = ctx->input_latency();
+  if (latency.count() != 1)
+    Fail(boost::format("%d latencies measured for one frame") %
+         latency.count());
+  if (latency.max() < std::chrono::milliseconds(5) ||
+      latency.Percentile(50) < std::chrono::milliseconds(5))
+    Fail(boost::format("latency of %d us shorter than elapsed time") %
+         latency.max().count());
+}
+
+/*
+ * A screen that takes a fixed time to present a frame.
+ */
+class SlowScreen : public FakeScreen {
+public:
+
+  inline SlowScreen(const std::chrono::milliseconds& flush_time)
+    : FakeScreen(Vector2<int>(640, 480)), flush_time_(flush_time) {}
+
+  inline virtual void Flush() {
+    std::this_thread::sleep_for(flush_time_);
+    FakeScreen::Flush();
+  }
+
+private:
+
+  std::chrono::milliseconds flush_time_;
+};
+
+/*
+ * Redisplays requested within a frame slot must wait for the next slot
+ * rather than being drawn as soon as the loop gets to them.
+ */
+void TestFramesAreAlignedToFrameInterval() {
+  Ptr<FakeApplicationLoop> loop(new FakeApplicationLoop());
+  auto screen = new FakeScreen(Vector2<int>(640, 480));
+  Ptr<DefaultApplicationContext> ctx(
+      new DefaultApplicationContext(loop, screen));
+  ctx->set_frame_interval(std::chrono::milliseconds(30));
+
+  ctx->PostRedisplay();
+  loop->RunWorkUnits();
+  if (screen->frame_count() != 1)
+    Fail(boost::format("first frame not drawn right away"));
+
+  for (int i = 0; i < 10; i++)
+    ctx->PostRedisplay(Rect2<int>(i, i, 10, 10));
+  loop->RunWorkUnits();
+  loop->RunExpiredTimers();
+  if (screen->frame_count() != 1)
+    Fail(boost::format("frame drawn before its slot"));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  loop->RunExpiredTimers();
+  if (screen->frame_count() != 2)
+    Fail(boost::format("%d frames drawn after the slot, expected 2") %
+         screen->frame_count());
+  if (ctx->frame_stats().frames != 2 || ctx->frame_stats().skipped != 0)
+    Fail(boost::format("frame stats: %d frames, %d skipped") %
+         ctx->frame_stats().frames % ctx->frame_stats().skipped);
+}
+
+/*
+ * A frame that overruns its slot must make the next frame skip the slots
+ * it missed, rather than being followed by a frame right away.
+ */
+void TestOverrunFramesSkipSlots() {
+  Ptr<FakeApplicationLoop> loop(new FakeApplicationLoop());
+  auto screen = new SlowScreen(std::chrono::milliseconds(50));
+  Ptr<DefaultApplicationContext> ctx(
+      new DefaultApplicationContext(loop, screen));
+  ctx->set_frame_interval(std::chrono::milliseconds(20));
+
+  ctx->PostRedisplay();
+  loop->RunWorkUnits();
+  ctx->PostRedisplay();
+  if (loop->RunWorkUnits())
+    Fail(boost::format("frame drawn right after an overrun frame"));
+
+  auto& stats = ctx->frame_stats();
+  if (stats.skipped < 2)
+    Fail(boost::format("%d slots skipped by a frame 2.5 slots long") %
+         stats.skipped);
+  if (stats.frame_time.max() < std::chrono::milliseconds(50))
+    Fail(boost::format("frame time of %d us is too short") %
+         stats.frame_time.max().count());
+}
+
+void TestDamageRegionMergesRects() {
+  DamageRegion damage(3);
+  damage.Add(Rect2<int>(0, 0, 10, 10));
+  damage.Add(Rect2<int>(5, 5, 10, 10));
+  if (damage.rects().size() != 1 ||
+      damage.rects()[0] != Rect2<int>(0, 0, 15, 15))
+    Fail(boost::format("overlapping rects not merged"));
+
+  damage.Add(Rect2<int>(2, 2, 3, 3));
+  damage.Add(Rect2<int>(20, 20, 0, 0));
+  if (damage.rects().size() != 1)
+    Fail(boost::format("contained or empty rects added"));
+
+  damage.Add(Rect2<int>(100, 0, 10, 10));
+  damage.Add(Rect2<int>(200, 0, 10, 10));
+  if (damage.rects().size() != 3)
+    Fail(boost::format("%d rects for 3 disjoint ones") %
+         damage.rects().size());
+
+  // A rect merging with others makes room instead of collapsing
+  damage.Add(Rect2<int>(105, 0, 100, 5));
+  if (damage.rects().size() != 2 ||
+      damage.bounds() != Rect2<int>(0, 0, 210, 15))
+    Fail(boost::format("rects merged across others not absorbed"));
+
+  damage.Add(Rect2<int>(0, 100, 10, 10));
+  damage.Add(Rect2<int>(300, 300, 10, 10));
+  if (damage.rects().size() != 1 ||
+      damage.rects()[0] != Rect2<int>(0, 0, 310, 310))
+    Fail(boost::format("rects over the limit not collapsed to bounds"));
+}
+
+/*
+ * A redisplay of a damaged region must only draw the widgets intersecting
+ * it, once per damaged rect they intersect.
+ */
+void TestRedisplayOnlyDrawsDamagedWidgets() {
+  Ptr<FakeApplicationLoop> loop(new FakeApplicationLoop());
+  auto screen = new FakeScreen(Vector2<int>(640, 480));
+  Ptr<ApplicationContext> ctx(new DefaultApplicationContext(loop, screen));
+  AbstractApplicationContextProvider ctx_prov(ctx);
+  Ptr<Window> win = new Window(ctx_prov);
+  Ptr<CountingWidget> left = new CountingWidget(ctx);
+  Ptr<CountingWidget> right = new CountingWidget(ctx);
+  win->set_child<FixedLayout>(new FixedLayout(ctx))
+      .AddWidget(left, Rect2<int>(0, 0, 100, 100))
+      .AddWidget(right, Rect2<int>(200, 0, 100, 100));
+  ctx->set_window(win);
+  ctx->PostRedisplay();
+  loop->RunWorkUnits();
+  if (left->draws != 1 || right->draws != 1)
+    Fail(boost::format("%d and %d draws on the first frame") %
+         left->draws % right->draws);
+
+  // The damage of the previous frame is repainted as well
+  ctx->PostRedisplay(Rect2<int>(10, 10, 5, 5));
+  loop->RunWorkUnits();
+  left->draws = right->draws = 0;
+
+  ctx->PostRedisplay(Rect2<int>(10, 10, 5, 5));
+  loop->RunWorkUnits();
+  if (left->draws != 1 || right->draws != 0)
+    Fail(boost::format("%d and %d draws for damage on the left widget") %
+         left->draws % right->draws);
+  if (screen->clip() != Rect2<int>(0, 0, 640, 480))
+    Fail(boost::format("clip region not reset after redisplay"));
+
+  // Damage repainted again is absorbed by the damage of the previous frame
+  left->draws = 0;
+  auto primitives = screen->primitive_count();
+  ctx->PostRedisplay(Rect2<int>(10, 10, 5, 5));
+  ctx->PostRedisplay(Rect2<int>(250, 50, 10, 10));
+  loop->RunWorkUnits();
+  if (left->draws != 1 || right->draws != 1)
+    Fail(boost::format("%d and %d draws for damage on both widgets") %
+         left->draws % right->draws);
+  if (screen->primitive_count() - primitives != 2)
+    Fail(boost::format("%d primitives drawn for two damaged widgets") %
+         (screen->primitive_count() - primitives));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestDeferredNotificationsAreCoalescedPerFrame();
+  TestInputLatencyIsMeasuredOnPresent();
+  TestFramesAreAlignedToFrameInterval();
+  TestOverrunFramesSkipSlots();
+  TestDamageRegionMergesRects();
+  TestRedisplayOnlyDrawsDamagedWidgets();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <boost/format.hpp>
+#include <grog/ui/app.h>
+#include <grog/ui/draw-gl.h>
+#include <grog/ui/layout.h>
+#include <grog/ui/widget.h>
+
+#include "grog/util/platform.h" // required for platform-dependent includes
+
+#if GROG_PLATFORM == GROG_PLATFORM_OSX
+  #include <OpenGL/gl.h>
+#elif GROG_PLATFORM == GROG_PLATFORM_WINDOWS
+  #include <Windows.h>
+  #include <GL/gl.h>
+#else
+  #include <GL/gl.h>
+#endif
+
+using namespace grog::ui;
+
+namespace {
+
+const int kRectangleCounts[] = { 1000, 10000, 100000 };
+
+// Frames are limited so every run draws about the same number of rectangles
+const int kMaxFrameCount = 100;
+const int kRectanglesPerRun = 1000000;
+
+/*
+ * A rectangle drawn in immediate mode, one draw call per rectangle. This is
+ * how OpenGLRectangle used to work, and it is kept here as a baseline.
+ */
+class ImmediateRectangle : public Rectangle {
+public:
+
+  ImmediateRectangle(const Color& color) : color_(color) {}
+
+  virtual void Draw(const Rect2<int>& screen_region) const {
+    glColor4f(color_.r, color_.g, color_.b, color_.a);
+    glBegin(GL_QUADS);
+      glVertex2f(screen_region.x,
+                 screen_region.y);
+      glVertex2f(screen_region.x + screen_region.w,
+                 screen_region.y);
+      glVertex2f(screen_region.x + screen_region.w,
+                 screen_region.y + screen_region.h);
+      glVertex2f(screen_region.x,
+                 screen_region.y + screen_region.h);
+    glEnd();
+  }
+
+private:
+
+  Color color_;
+};
+
+class RectangleWidget : public Widget, public MouseUnresponder {
+public:
+
+  RectangleWidget(const Ptr<Rectangle>& rect) : rect_(rect) {}
+
+  virtual void Draw(const Rect2<int>& screen_region) const {
+    rect_->Draw(screen_region);
+  }
+
+  virtual bool Respond(const MouseButtonEvent& ev) { return false; }
+
+  virtual bool Respond(const MouseMotionEvent& ev) { return false; }
+
+private:
+
+  Ptr<Rectangle> rect_;
+};
+
+const Color* kColors[] = {
+  &Color::kLightRed, &Color::kLightGreen, &Color::kLightBlue,
+};
+
+Ptr<FixedLayout> MakeLayout(
+    const std::function<Ptr<Rectangle>(const Color&)>& create_rect,
+    const Vector2<int>& screen_size,
+    int rect_count) {
+  Ptr<FixedLayout> layout = new FixedLayout();
+  for (int i = 0; i < rect_count; i++) {
+    Ptr<Widget> widget = new RectangleWidget(create_rect(*kColors[i % 3]));
+    layout->AddWidget(widget, Rect2<int>(
+        (i * 7) % (screen_size.x - 8), (i * 13) % (screen_size.y - 8), 8, 8));
+  }
+  return layout;
+}
+
+void RunBenchmark(const char* name, Screen& screen, Widget& root,
+                  int rect_count) {
+  auto gl_screen = dynamic_cast<OpenGLScreen*>(&screen);
+  Rect2<int> region(Vector2<int>(0, 0), screen.size());
+  int frame_count = std::min(kMaxFrameCount, kRectanglesPerRun / rect_count);
+  if (gl_screen) {
+    gl_screen->ResetStats();
+    gl_screen->ResetStateStats();
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frame_count; i++) {
+    screen.Clear();
+    root.Render(region);
+    screen.Flush();
+  }
+  if (gl_screen)
+    glFinish();
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+  std::cout << boost::format("%-10s %6d rects: %8.3f ms/frame") %
+      name % rect_count %
+      (elapsed.count() / 1000.0 / frame_count);
+  if (gl_screen) {
+    // Immediate mode rectangles bypass the batch, one draw call each
+    auto draw_calls = gl_screen->stats().draw_calls;
+    if (!gl_screen->stats().primitives)
+      draw_calls = rect_count * frame_count;
+    auto& state_stats = gl_screen->state_stats();
+    std::cout << boost::format(", %8.1f draw calls/frame") %
+        (double(draw_calls) / frame_count);
+    std::cout << boost::format(", %6.1f/%6.1f state changes/frame "
+                               "issued/filtered") %
+        (double(state_stats.issued) / frame_count) %
+        (double(state_stats.filtered) / frame_count);
+  }
+  std::cout << std::endl;
+}
+
+} // anonymous namespace
+
+/*
+ * Usage: bench-draw [sdl|software]
+ */
+void GrogMain(const GrogMainArgs& args) throw (grog::util::Error) {
+  auto props = Application::kDefaultProperties;
+  if (args.size() > 1)
+    props[Application::kPropNameAppEngine] =
+        std::string(args[1].begin(), args[1].end());
+  Application& app = Application::init(props);
+  auto& screen = app.context()->screen();
+
+  auto gl_screen = dynamic_cast<OpenGLScreen*>(&screen);
+  if (gl_screen && !gl_screen->instancing_supported())
+    std::cout << "instanced rendering not supported, "
+              << "rectangles are batched" << std::endl;
+
+  for (int rect_count : kRectangleCounts) {
+    if (gl_screen) {
+      auto immediate = MakeLayout([](const Color& color) -> Ptr<Rectangle> {
+        return new ImmediateRectangle(color);
+      }, screen.size(), rect_count);
+      RunBenchmark("immediate", screen, *immediate, rect_count);
+
+      // Immediate mode rectangles set the color behind the screen
+      gl_screen->InvalidateState();
+    }
+
+    auto shapes = MakeLayout([&screen](const Color& color) {
+      return screen.shape_factory().CreateRectangle(color);
+    }, screen.size(), rect_count);
+    if (gl_screen) {
+      // Compare the batched vertex array with one instanced call per batch
+      gl_screen->set_instancing(false);
+      RunBenchmark("batched", screen, *shapes, rect_count);
+      gl_screen->set_instancing(true);
+      if (gl_screen->instancing())
+        RunBenchmark("instanced", screen, *shapes, rect_count);
+    } else {
+      RunBenchmark(props[Application::kPropNameAppEngine].c_str(),
+                   screen, *shapes, rect_count);
+    }
+
+    // Static content is replayed from the recording of the first frame
+    shapes->set_retained(true);
+    RunBenchmark("retained", screen, *shapes, rect_count);
+
+    // Static content is composited from a layer drawn on the first frame
+    shapes->set_retained(false);
+    shapes->set_cached_as_layer(true);
+    RunBenchmark("layer", screen, *shapes, rect_count);
+  }
+}
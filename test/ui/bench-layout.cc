@@ -0,0 +1,130 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <boost/format.hpp>
+#include <grog/ui/layout.h>
+
+#include "fake.h"
+
+using namespace grog::test;
+
+namespace {
+
+const int kCanvasSize = 4000;
+const int kQueryCount = 20000;
+const int kFrameCount = 1000;
+
+/*
+ * Run the given hit test function against random positions, returning the
+ * average time per query in nanoseconds.
+ */
+template <typename HitTest>
+double MeasureQueries(const std::vector<Vector2<int>>& positions,
+                      HitTest hit_test, int& hits) {
+  hits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (auto& pos : positions) {
+    if (hit_test(pos))
+      hits++;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+  return double(elapsed.count()) / positions.size();
+}
+
+void RunBenchmark(int child_count) {
+  auto ctx = NewFakeContext();
+  FixedLayout layout(ctx);
+  std::srand(child_count);
+  for (int i = 0; i < child_count; i++) {
+    layout.AddWidget(new FakeWidget(ctx), Rect2<int>(
+        std::rand() % kCanvasSize, std::rand() % kCanvasSize, 50, 50));
+  }
+
+  std::vector<Vector2<int>> positions;
+  for (int i = 0; i < kQueryCount; i++)
+    positions.push_back(Vector2<int>(
+        std::rand() % kCanvasSize, std::rand() % kCanvasSize));
+
+  int linear_hits, indexed_hits;
+  auto linear = MeasureQueries(positions, [&layout](const Vector2<int>& pos) {
+    return layout.Find(Layout::OnPosition(pos)).valid();
+  }, linear_hits);
+  auto indexed = MeasureQueries(positions, [&layout](const Vector2<int>& pos) {
+    return layout.FindAt(pos).valid();
+  }, indexed_hits);
+
+  std::cout << boost::format(
+      "%6d children: linear scan %10.1f ns/query, "
+      "grid index %8.1f ns/query (%d/%d hits)") %
+      child_count % linear % indexed % linear_hits % indexed_hits << std::endl;
+
+  // The fake screen is 640x480, a small window on the canvas
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kFrameCount; i++)
+    layout.Draw(Rect2<int>(0, 0, kCanvasSize, kCanvasSize));
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+  auto& stats = layout.cull_stats();
+  std::cout << boost::format(
+      "%6d children: draw %10.1f ns/frame (%d drawn, %d culled per frame)") %
+      child_count % (double(elapsed.count()) / kFrameCount) %
+      (stats.drawn / kFrameCount) % (stats.offscreen / kFrameCount) <<
+      std::endl;
+}
+
+void RunScrollBenchmark(std::size_t row_count) {
+  auto ctx = NewFakeContext();
+  ScrollLayout layout([&ctx](std::size_t row) -> Ptr<Widget> {
+    return new FakeWidget(ctx);
+  }, row_count, 20, ctx);
+  layout.Draw(Rect2<int>(0, 0, 640, 480));
+
+  // Scroll a few rows per frame, back and forth over the whole list
+  long step = 7 * 20;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kFrameCount; i++) {
+    auto offset = layout.scroll_offset();
+    layout.ScrollBy(step);
+    if (layout.scroll_offset() == offset) {
+      step = -step;
+      layout.ScrollBy(step);
+    }
+    layout.Draw(Rect2<int>(0, 0, 640, 480));
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+  std::cout << boost::format(
+      "%7d rows: scroll and draw %10.1f ns/frame (%d rows created)") %
+      row_count % (double(elapsed.count()) / kFrameCount) %
+      layout.materialized_count() << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  for (int count : { 10, 100, 1000, 10000 })
+    RunBenchmark(count);
+  for (std::size_t count : { 50, 1000000 })
+    RunScrollBenchmark(count);
+  return 0;
+}
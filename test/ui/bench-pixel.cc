@@ -0,0 +1,100 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <grog/ui/pixel.h>
+
+using namespace grog::ui;
+
+namespace {
+
+const double kMinDuration = 0.2; // seconds per measurement
+
+const PixelInstructionSet kInstructionSets[] = {
+  kScalarInstructionSet,
+  kSSE2InstructionSet,
+  kAVX2InstructionSet,
+};
+
+const char* kInstructionSetNames[] = { "scalar", "sse2", "avx2" };
+
+struct WindowSize {
+  int w, h;
+};
+
+const WindowSize kWindowSizes[] = {
+  { 640, 480 },
+  { 1280, 720 },
+  { 1920, 1080 },
+  { 2560, 1440 },
+};
+
+typedef void (*SpanKernel)(UInt32* dst, std::size_t len, UInt32 pixel);
+
+/*
+ * Run the kernel over every row of a buffer of given size for at least
+ * kMinDuration seconds, returning the throughput in megapixels per second.
+ */
+double Measure(SpanKernel kernel, const WindowSize& size, UInt32 pixel) {
+  std::vector<UInt32> buffer(size.w * size.h, PackPixel(0, 0, 0, 255));
+  long frames = 0;
+  double elapsed = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (int y = 0; y < size.h; y++)
+      kernel(&buffer[y * size.w], size.w, pixel);
+    frames++;
+    elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < kMinDuration);
+
+  // Prevent the compiler from discarding the buffer
+  volatile UInt32 sink = buffer[buffer.size() / 2];
+  (void) sink;
+  return double(frames) * size.w * size.h / elapsed / 1e6;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  std::cout << "best kernels: " <<
+      kInstructionSetNames[PixelKernels::Best().instruction_set] << std::endl;
+  for (auto instruction_set : kInstructionSets) {
+    auto kernels = PixelKernels::ForInstructionSet(instruction_set);
+    if (!kernels) {
+      std::cout << boost::format("%-6s unsupported") %
+          kInstructionSetNames[instruction_set] << std::endl;
+      continue;
+    }
+    for (auto& size : kWindowSizes) {
+      auto fill = Measure(kernels.value().fill_span, size,
+                          PackPixel(40, 80, 120, 255));
+      auto blend = Measure(kernels.value().blend_span, size,
+                           PackPixel(200, 100, 50, 128));
+      std::cout << boost::format(
+          "%-6s %4dx%-4d fill: %8.1f Mpx/s, blend: %8.1f Mpx/s") %
+          kInstructionSetNames[instruction_set] % size.w % size.h %
+          fill % blend << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,189 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GROG_TEST_UI_FAKE_H
+#define GROG_TEST_UI_FAKE_H
+
+#include <vector>
+
+#include <grog/ui/app.h>
+#include <grog/ui/draw.h>
+#include <grog/ui/widget.h>
+
+namespace grog { namespace test {
+
+using namespace grog::ui;
+
+/**
+ * An application loop that only runs its work units when requested to. It
+ * allows widgets to be exercised without a window system.
+ */
+class FakeApplicationLoop : public AbstractApplicationLoop {
+public:
+
+  inline virtual void AddWorkUnit(const WorkUnit& wu) {
+    work_units_.push_back(wu);
+  }
+
+  /**
+   * Run the work units added so far, returning how many were run.
+   */
+  inline std::size_t RunWorkUnits() {
+    std::vector<WorkUnit> work_units;
+    work_units.swap(work_units_);
+    for (auto& wu : work_units) {
+      if (wu())
+        work_units_.push_back(wu);
+    }
+    return work_units.size();
+  }
+
+  inline virtual void Run() {}
+
+  inline virtual void Stop() {}
+
+  using AbstractApplicationLoop::HandleMouseMotionEvent;
+  using AbstractApplicationLoop::HandleMouseButtonEvent;
+  using AbstractApplicationLoop::RunExpiredTimers;
+
+private:
+
+  std::vector<WorkUnit> work_units_;
+};
+
+class FakeRectangle : public Rectangle {
+public:
+
+  inline FakeRectangle(Screen& screen, const PackedColor& color)
+    : screen_(screen), color_(color) {}
+
+  inline virtual void Draw(const Rect2<int>& screen_region) const {
+    screen_.FillRect(screen_region, color_);
+  }
+
+private:
+
+  Screen& screen_;
+  PackedColor color_;
+};
+
+class FakeShapeFactory : public ShapeFactory {
+public:
+
+  inline FakeShapeFactory(Screen& screen) : screen_(screen) {}
+
+  inline virtual Ptr<Rectangle> CreateRectangle(const PackedColor& color) {
+    return new FakeRectangle(screen_, color);
+  }
+
+private:
+
+  Screen& screen_;
+};
+
+/**
+ * A screen that draws nothing, but counts the fills it was requested.
+ */
+class FakeScreen : public Screen {
+public:
+
+  inline FakeScreen(const Vector2<int>& size)
+    : size_(size), clip_(Vector2<int>(0, 0), size), frame_count_(0),
+      primitive_count_(0), shape_factory_(*this) {}
+
+  inline virtual Vector2<int> size() const { return size_; }
+
+  inline virtual Rect2<int> clip() const { return clip_; }
+
+  inline virtual void set_clip(const Rect2<int>& region) { clip_ = region; }
+
+  inline virtual void Clear() {}
+
+  inline virtual void Flush() { frame_count_++; }
+
+  inline virtual ShapeFactory& shape_factory() { return shape_factory_; }
+
+  inline unsigned long frame_count() const { return frame_count_; }
+
+  inline virtual unsigned long primitive_count() const {
+    return primitive_count_;
+  }
+
+protected:
+
+  inline virtual void RenderFill(const Rect2<int>& region,
+                                 const PackedColor& color) {
+    primitive_count_++;
+  }
+
+private:
+
+  Vector2<int> size_;
+  Rect2<int> clip_;
+  unsigned long frame_count_;
+  unsigned long primitive_count_;
+  FakeShapeFactory shape_factory_;
+};
+
+/**
+ * A widget that neither draws nor responds to anything.
+ */
+class FakeWidget : public Widget, public MouseUnresponder {
+public:
+
+  inline FakeWidget(const Ptr<ApplicationContext>& ctx) : Widget(ctx) {}
+
+  inline virtual void Draw(const Rect2<int>& screen_region) const {}
+
+  inline virtual bool Respond(const MouseButtonEvent& ev) { return false; }
+
+  inline virtual bool Respond(const MouseMotionEvent& ev) { return false; }
+};
+
+/**
+ * A widget that fills its region, counting how many times it was drawn.
+ */
+class CountingWidget : public FakeWidget {
+public:
+
+  inline CountingWidget(const Ptr<ApplicationContext>& ctx,
+                        const Color& color = Color::kRed)
+    : FakeWidget(ctx), draws(0),
+      rect_(shape_factory().CreateRectangle(color)) {}
+
+  inline virtual void Draw(const Rect2<int>& screen_region) const {
+    draws++;
+    rect_->Draw(screen_region);
+  }
+
+  mutable unsigned long draws;
+
+private:
+
+  Ptr<Rectangle> rect_;
+};
+
+inline Ptr<ApplicationContext> NewFakeContext(
+    const Ptr<FakeApplicationLoop>& loop = new FakeApplicationLoop()) {
+  return new DefaultApplicationContext(
+      loop, new FakeScreen(Vector2<int>(640, 480)));
+}
+
+}} // namespace grog::test
+
+#endif // GROG_TEST_UI_FAKE_H
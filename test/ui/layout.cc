@@ -0,0 +1,584 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <grog/ui/draw-soft.h>
+#include <grog/ui/layout.h>
+#include <grog/ui/pixel.h>
+
+#include "fake.h"
+
+using namespace grog::test;
+
+/*
+ * Count every allocation performed by the program, so the test can check
+ * hot paths don't allocate.
+ */
+namespace {
+
+unsigned long allocation_count = 0;
+
+} // anonymous namespace
+
+void* operator new(std::size_t size) {
+  allocation_count++;
+  void* p = std::malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char* description) {
+  if (!condition) {
+    std::cerr << "FAILED: " << description << std::endl;
+    failures++;
+  }
+}
+
+void TestFindAtRespectsZOrder() {
+  auto ctx = NewFakeContext();
+  FixedLayout layout(ctx);
+  Ptr<Widget> back = new FakeWidget(ctx);
+  Ptr<Widget> front = new FakeWidget(ctx);
+  layout
+      .AddWidget(front, Rect2<int>(10, 10, 50, 50))
+      .AddWidget(back, Rect2<int>(0, 0, 100, 100));
+
+  auto child = layout.FindAt(Vector2<int>(20, 20));
+  Check(child && child.value().widget == front, "front child is found first");
+  child = layout.FindAt(Vector2<int>(80, 80));
+  Check(child && child.value().widget == back, "back child is found out of front");
+  Check(!layout.FindAt(Vector2<int>(200, 200)), "nothing found out of children");
+
+  layout.BringToFront(back);
+  child = layout.FindAt(Vector2<int>(20, 20));
+  Check(child && child.value().widget == back, "raised child is found first");
+
+  layout.MoveWidget(back, Vector2<int>(300, 300));
+  child = layout.FindAt(Vector2<int>(20, 20));
+  Check(child && child.value().widget == front, "moved child is not found");
+  child = layout.FindAt(Vector2<int>(350, 350));
+  Check(child && child.value().widget == back, "moved child is found on new place");
+}
+
+void TestMouseMotionDoesNotAllocate() {
+  Ptr<FakeApplicationLoop> loop = new FakeApplicationLoop();
+  auto ctx = NewFakeContext(loop);
+  AbstractApplicationContextProvider ctx_prov(ctx);
+  Ptr<Window> win = new Window(ctx_prov);
+  ctx->set_window(win);
+
+  auto& layout = win->set_child<FixedLayout>(new FixedLayout(ctx));
+  for (int i = 0; i < 1000; i++) {
+    layout.AddWidget(new FakeWidget(ctx),
+                     Rect2<int>((i * 37) % 600, (i * 53) % 440, 40, 40));
+  }
+
+  auto motion = [&loop](int i) {
+    loop->HandleMouseMotionEvent(MouseMotionEvent(
+        Vector2<int>(i % 640, (i * 7) % 480), Vector2<int>(1, 1)));
+  };
+
+  // Warm up, so lazily initialized state doesn't count
+  for (int i = 0; i < 100; i++)
+    motion(i);
+
+  auto before = allocation_count;
+  for (int i = 0; i < 10000; i++)
+    motion(i);
+  auto allocations = allocation_count - before;
+
+  if (allocations)
+    std::cerr << allocations << " allocations for 10000 motion events"
+              << std::endl;
+  Check(allocations == 0, "mouse motion does not allocate");
+}
+
+void TestDrawStatsAreAccountedPerWidget() {
+  auto ctx = NewFakeContext();
+  FixedLayout layout(ctx);
+  Ptr<Widget> shown = new FakeWidget(ctx);
+  Ptr<Widget> hidden = new FakeWidget(ctx);
+  layout
+      .AddWidget(shown, Rect2<int>(10, 10, 50, 50))
+      .AddWidget(hidden, Rect2<int>(1000, 1000, 50, 50));
+
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  Check(layout.draw_stats().draws == 0, "no stats while disabled");
+
+  Widget::set_draw_stats_enabled(true);
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  Widget::set_draw_stats_enabled(false);
+
+  Check(layout.draw_stats().draws == 2, "layout draws are counted");
+  Check(shown->draw_stats().draws == 2, "child draws are counted");
+  Check(hidden->draw_stats().draws == 0, "culled child draws are not counted");
+  Check(layout.draw_stats().draw_time >= shown->draw_stats().draw_time,
+        "layout draw time includes its children");
+
+  layout.ResetDrawStats();
+  Check(layout.draw_stats().draws == 0, "stats are reset");
+}
+
+class OpaqueWidget : public FakeWidget {
+public:
+
+  inline OpaqueWidget(const Ptr<ApplicationContext>& ctx) : FakeWidget(ctx) {}
+
+  inline virtual bool opaque() const { return true; }
+};
+
+void TestDrawCullsHiddenChildren() {
+  auto ctx = NewFakeContext();
+  FixedLayout layout(ctx);
+  Ptr<Widget> cover = new OpaqueWidget(ctx);
+  Ptr<Widget> covered = new FakeWidget(ctx);
+  Ptr<Widget> partial = new FakeWidget(ctx);
+  Ptr<Widget> offscreen = new FakeWidget(ctx);
+  layout
+      .AddWidget(cover, Rect2<int>(0, 0, 200, 200))
+      .AddWidget(covered, Rect2<int>(50, 50, 100, 100))
+      .AddWidget(partial, Rect2<int>(150, 150, 100, 100))
+      .AddWidget(offscreen, Rect2<int>(5000, 5000, 100, 100));
+
+  Widget::set_draw_stats_enabled(true);
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  auto stats = layout.cull_stats();
+  Check(stats.drawn == 3 && stats.offscreen == 1 && stats.occluded == 0,
+        "only offscreen children are culled by default");
+
+  layout.ResetCullStats();
+  layout.set_occlusion_culling(true);
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  stats = layout.cull_stats();
+  Check(stats.drawn == 2 && stats.offscreen == 1 && stats.occluded == 1,
+        "children behind opaque siblings are culled");
+  Check(covered->draw_stats().draws == 1, "occluded child is not drawn");
+  Check(partial->draw_stats().draws == 2, "partially covered child is drawn");
+
+  // Once raised, the formerly covered child is drawn on top
+  layout.BringToFront(covered);
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  Check(covered->draw_stats().draws == 2, "raised child is drawn");
+  Widget::set_draw_stats_enabled(false);
+
+  // A partial clip only exposes the children under it, and the part of
+  // them under the clip is what must be covered to cull them
+  auto& screen = ctx->screen();
+  screen.set_clip(Rect2<int>(160, 160, 20, 20));
+  layout.ResetCullStats();
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  screen.ResetClip();
+  stats = layout.cull_stats();
+  Check(stats.offscreen == 2, "children out of the clip are culled");
+  Check(stats.drawn == 1 && stats.occluded == 1,
+        "children covered within the clip are culled");
+}
+
+/*
+ * A row widget that knows which row it stands for.
+ */
+class RowWidget : public FakeWidget {
+public:
+
+  inline RowWidget(const Ptr<ApplicationContext>& ctx, std::size_t row)
+    : FakeWidget(ctx), row(row) {}
+
+  std::size_t row;
+};
+
+std::size_t RowAt(Layout& layout, const Vector2<int>& pos) {
+  auto child = layout.FindAt(pos);
+  if (!child)
+    return std::size_t(-1);
+  return static_cast<RowWidget&>(*child.value().widget).row;
+}
+
+void TestScrollLayoutOnlyCreatesRowsInSight() {
+  auto ctx = NewFakeContext();
+  unsigned long created = 0;
+  ScrollLayout layout([&ctx, &created](std::size_t row) -> Ptr<Widget> {
+    created++;
+    return new RowWidget(ctx, row);
+  }, 1000000, 20, ctx);
+
+  Check(layout.materialized_count() == 0, "no rows created before drawn");
+  layout.Render(Rect2<int>(0, 0, 640, 100));
+  Check(layout.materialized_count() == 5 && created == 5,
+        "only rows in sight are created");
+  Check(RowAt(layout, Vector2<int>(10, 45)) == 2, "row found at position");
+
+  // Scrolling half a row keeps the widgets and shows one more row
+  layout.ScrollBy(10);
+  Check(layout.materialized_count() == 6 && created == 6,
+        "rows still in sight are kept");
+  Check(RowAt(layout, Vector2<int>(10, 45)) == 2, "row found once scrolled");
+  Check(RowAt(layout, Vector2<int>(10, 5)) == 0, "partially shown row found");
+
+  layout.ScrollTo(1L << 40);
+  Check(layout.scroll_offset() == 20L * 1000000 - 100,
+        "scroll clamped to the last row");
+  Check(RowAt(layout, Vector2<int>(10, 99)) == 999999, "last row found");
+  Check(layout.materialized_count() == 5, "rows out of sight are dropped");
+
+  layout.Respond(MouseButtonEvent(
+      kWheelUpMouseButton, kMouseButtonPressed, Vector2<int>(10, 10), 3));
+  Check(layout.scroll_offset() == 20L * 1000000 - 160,
+        "wheel scrolls a row per click");
+
+  layout.set_row_count(3);
+  Check(layout.scroll_offset() == 0 && layout.materialized_count() == 3,
+        "fewer rows than fit in the viewport are all shown");
+  Check(RowAt(layout, Vector2<int>(10, 70)) == std::size_t(-1),
+        "nothing found past the last row");
+
+  ScrollLayout flat([&ctx](std::size_t row) -> Ptr<Widget> {
+    return new RowWidget(ctx, row);
+  }, 1000, 0, ctx);
+  flat.Render(Rect2<int>(0, 0, 640, 100));
+  Check(flat.row_height() == 1 && flat.materialized_count() == 100,
+        "rows lower than a pixel are one pixel high");
+}
+
+void TestRetainedWidgetsReplayTheirOutput() {
+  auto ctx = NewFakeContext();
+  auto& screen = ctx->screen();
+  FixedLayout layout(ctx);
+  Ptr<CountingWidget> plain = new CountingWidget(ctx);
+  Ptr<CountingWidget> retained = new CountingWidget(ctx);
+  retained->set_retained(true);
+  layout
+      .AddWidget(plain, Rect2<int>(0, 0, 50, 50))
+      .AddWidget(retained, Rect2<int>(100, 100, 50, 50));
+  layout.set_retained(true);
+  Check(plain->parent() == &layout, "layout is the parent of its children");
+
+  // Only the damaged region is clipped, but the whole layout is recorded
+  screen.set_clip(Rect2<int>(0, 0, 10, 10));
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  screen.ResetClip();
+  auto primitives = screen.primitive_count();
+  Check(plain->draws == 1 && retained->draws == 1, "children drawn once");
+  Check(primitives == 2, "recorded output is replayed");
+
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  Check(plain->draws == 1 && retained->draws == 1,
+        "children not drawn while the layout is valid");
+  Check(screen.primitive_count() == primitives + 2,
+        "replayed output is complete");
+
+  // The retained child keeps its recording when a sibling is invalidated
+  plain->Invalidate();
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  Check(plain->draws == 2 && retained->draws == 1,
+        "only invalidated children are drawn again");
+
+  layout.MoveWidget(plain, Vector2<int>(200, 200));
+  layout.Render(Rect2<int>(0, 0, 640, 480));
+  Check(plain->draws == 3, "layout changes invalidate the layout");
+
+  layout.Render(Rect2<int>(10, 10, 640, 480));
+  Check(retained->draws == 2, "widgets are drawn again on another region");
+
+  layout.set_retained(false);
+  layout.Render(Rect2<int>(10, 10, 640, 480));
+  Check(plain->draws == 5, "widgets are drawn when no longer retained");
+}
+
+UInt32 PixelAt(const SoftwareScreen& screen, int x, int y) {
+  return screen.pixels()[y * screen.size().x + x];
+}
+
+void TestLayersAreCompositedUntilInvalidated() {
+  Ptr<SoftwareScreen> screen = new SoftwareScreen(Vector2<int>(200, 100));
+  Ptr<ApplicationContext> ctx =
+      new DefaultApplicationContext(new FakeApplicationLoop(), screen);
+  Color translucent = { 1.0f, 0.0f, 0.0f, 0.5f };
+  FixedLayout layout(ctx);
+  Ptr<CountingWidget> background = new CountingWidget(ctx, Color::kBlue);
+  Ptr<CountingWidget> left = new CountingWidget(ctx, translucent);
+  Ptr<CountingWidget> right = new CountingWidget(ctx, translucent);
+  layout
+      .AddWidget(left, Rect2<int>(0, 0, 100, 100))
+      .AddWidget(right, Rect2<int>(100, 0, 100, 100))
+      .AddWidget(background, Rect2<int>(0, 0, 200, 100));
+
+  auto frame = [&screen, &layout]() {
+    screen->Clear();
+    layout.Render(Rect2<int>(0, 0, 200, 100));
+    screen->Flush();
+  };
+  frame();
+  auto expected = PixelAt(*screen, 50, 50);
+
+  left->set_cached_as_layer(true);
+  right->set_cached_as_layer(true);
+  frame();
+  frame();
+  Check(left->draws == 2 && right->draws == 2,
+        "cached widgets are drawn once");
+  Check(PixelAt(*screen, 50, 50) == expected &&
+        PixelAt(*screen, 150, 50) == expected,
+        "translucent layers composite as drawn directly");
+  auto& cache = screen->layer_cache();
+  Check(cache.size() == 2 && cache.memory_usage() == 2 * 100 * 100 * 4,
+        "layer memory is accounted");
+
+  left->Invalidate();
+  frame();
+  Check(left->draws == 3 && right->draws == 2,
+        "only invalidated layers are drawn again");
+
+  // Only one layer fits, so each frame evicts the other
+  cache.set_budget(100 * 100 * 4);
+  Check(cache.size() == 1, "layers out of budget are dropped");
+  cache.ResetStats();
+  frame();
+  frame();
+  Check(cache.stats().evictions == 4, "least recently used layers evicted");
+  Check(PixelAt(*screen, 50, 50) == expected &&
+        PixelAt(*screen, 150, 50) == expected,
+        "evicted layers are drawn again");
+
+  left->set_cached_as_layer(false);
+  right->set_cached_as_layer(false);
+  Check(cache.size() == 0, "layers are released once no longer cached");
+}
+
+void TestWidgetAddedTwiceIsPlacedOnce() {
+  auto ctx = NewFakeContext();
+  FixedLayout layout(ctx);
+  Ptr<Widget> widget = new CountingWidget(ctx);
+  layout
+      .AddWidget(widget, Rect2<int>(0, 0, 10, 10))
+      .AddWidget(widget, Rect2<int>(50, 50, 10, 10));
+
+  int placements = 0;
+  layout.ForEach([&placements](const Layout::WidgetPlacement&) {
+    placements++;
+  });
+  Check(placements == 1, "widget added twice is placed once");
+  Check(!layout.FindAt(Vector2<int>(5, 5)), "former placement not found");
+  Check(layout.FindWidgetAt(Vector2<int>(55, 55)), "new placement found");
+
+  layout.MoveWidget(widget, Vector2<int>(100, 100));
+  Check(!layout.FindAt(Vector2<int>(55, 55)) &&
+        layout.FindWidgetAt(Vector2<int>(105, 105)),
+        "widget added twice is moved");
+}
+
+/*
+ * A widget dropped by its layout in the middle of a drag must stay alive
+ * until dropped.
+ */
+void TestDraggedWidgetOutlivesRemoval() {
+  auto ctx = NewFakeContext();
+  std::weak_ptr<Widget> created;
+  ScrollLayout layout([&ctx, &created](std::size_t row) -> Ptr<Widget> {
+    Ptr<Widget> widget = new RowWidget(ctx, row);
+    if (row == 0)
+      created = widget;
+    return widget;
+  }, 100, 10, ctx);
+  layout.Render(Rect2<int>(0, 0, 100, 50));
+
+  std::size_t dragged = std::size_t(-1), dropped = std::size_t(-1);
+  DragAndDropResponder responder(
+      [&dragged](const Widget& widget, const Vector2<int>& pos,
+                 const Vector2<int>& mov) {
+        dragged = static_cast<const RowWidget&>(widget).row;
+      },
+      [&dropped](const Widget& widget, const Vector2<int>& from,
+                 const Vector2<int>& to) {
+        dropped = static_cast<const RowWidget&>(widget).row;
+      });
+  responder.Respond(layout, MouseButtonEvent(
+      kLeftMouseButton, kMouseButtonPressed, Vector2<int>(5, 5)));
+
+  // Scrolling drops the widget of the first row
+  layout.ScrollTo(500);
+  Check(!created.expired(), "dragged widget kept alive");
+  responder.Respond(layout, MouseMotionEvent(
+      Vector2<int>(10, 10), Vector2<int>(5, 5)));
+  responder.Respond(layout, MouseButtonEvent(
+      kLeftMouseButton, kMouseButtonReleased, Vector2<int>(10, 10)));
+  Check(dragged == 0 && dropped == 0, "dragged widget dragged and dropped");
+  Check(created.expired(), "dragged widget released once dropped");
+}
+
+void TestDrawCostOverlayShadesChildrenInSight() {
+  Ptr<SoftwareScreen> screen = new SoftwareScreen(Vector2<int>(200, 100));
+  Ptr<ApplicationContext> ctx =
+      new DefaultApplicationContext(new FakeApplicationLoop(), screen);
+  Ptr<FixedLayout> layout = new FixedLayout(ctx);
+  layout->AddWidget(new CountingWidget(ctx, Color::kGreen),
+                    Rect2<int>(0, 0, 50, 50));
+  layout->AddWidget(new CountingWidget(ctx, Color::kGreen),
+                    Rect2<int>(100, 0, 50, 50));
+  layout->AddWidget(new CountingWidget(ctx, Color::kGreen),
+                    Rect2<int>(300, 0, 50, 50));
+  DrawCostOverlay overlay(ctx, layout);
+
+  Widget::set_draw_stats_enabled(true);
+  overlay.Render(Rect2<int>(0, 0, 200, 100));
+  screen->Clear();
+  auto primitives = screen->primitive_count();
+  overlay.Render(Rect2<int>(0, 0, 200, 100));
+  screen->Flush();
+  Widget::set_draw_stats_enabled(false);
+
+  // Two children drawn and shaded, the one out of sight neither
+  Check(screen->primitive_count() - primitives == 4,
+        "only children in sight are shaded");
+  PackedColor pixel;
+  pixel.value = PixelAt(*screen, 25, 25);
+  Check(pixel.g() > 0 && (pixel.r() > 0 || pixel.b() > 0),
+        "children stay visible below the shading");
+}
+
+/*
+ * Widgets outliving their container, or removed from it, must not keep a
+ * dangling parent to invalidate.
+ */
+void TestParentIsClearedOnRemoval() {
+  auto ctx = NewFakeContext();
+  Ptr<CountingWidget> child = new CountingWidget(ctx);
+  {
+    FixedLayout layout(ctx);
+    layout.AddWidget(child, Rect2<int>(0, 0, 10, 10));
+    Check(child->parent() == &layout, "parent set when added");
+  }
+  Check(!child->parent(), "parent cleared when the layout is destroyed");
+  child->Invalidate();
+
+  AbstractApplicationContextProvider ctx_prov(ctx);
+  Ptr<CountingWidget> other = new CountingWidget(ctx);
+  {
+    Window win(ctx_prov);
+    win.set_child(child);
+    win.set_child(other);
+    Check(!child->parent(), "parent cleared when the child is replaced");
+  }
+  Check(!other->parent(), "parent cleared when the wrapper is destroyed");
+
+  std::vector<Ptr<Widget>> rows;
+  for (int i = 0; i < 10; i++)
+    rows.push_back(new CountingWidget(ctx));
+  {
+    ScrollLayout layout([&rows](std::size_t row) { return rows[row]; },
+                        10, 10, ctx);
+    layout.Render(Rect2<int>(0, 0, 100, 50));
+    layout.ScrollTo(50);
+    Check(!rows[0]->parent() && rows[5]->parent() == &layout,
+          "parent cleared when rows are scrolled out of sight");
+  }
+  Check(!rows[5]->parent(), "parent cleared when the list is destroyed");
+}
+
+void TestEmptySoftwareScreenDrawsNothing() {
+  Ptr<SoftwareScreen> screen = new SoftwareScreen(Vector2<int>(0, 0));
+  Ptr<ApplicationContext> ctx =
+      new DefaultApplicationContext(new FakeApplicationLoop(), screen);
+  CountingWidget widget(ctx);
+  screen->Clear();
+  widget.Render(Rect2<int>(0, 0, 10, 10));
+  screen->Flush();
+  Check(widget.draws == 1 && screen->pixels().empty(),
+        "screen of zero size draws nothing");
+}
+
+/*
+ * A software screen counting the layers it creates.
+ */
+class LayerCountingScreen : public SoftwareScreen {
+public:
+
+  LayerCountingScreen(const Vector2<int>& size)
+    : SoftwareScreen(size), layers(0) {}
+
+  virtual Ptr<Layer> CreateLayer(const Vector2<int>& size) {
+    layers++;
+    return SoftwareScreen::CreateLayer(size);
+  }
+
+  int layers;
+};
+
+void TestLayersOverBudgetAreNotCreated() {
+  Ptr<LayerCountingScreen> screen =
+      new LayerCountingScreen(Vector2<int>(200, 100));
+  Ptr<ApplicationContext> ctx =
+      new DefaultApplicationContext(new FakeApplicationLoop(), screen);
+  FixedLayout layout(ctx);
+  Ptr<CountingWidget> small = new CountingWidget(ctx, Color::kBlue);
+  Ptr<CountingWidget> large = new CountingWidget(ctx, Color::kRed);
+  layout
+      .AddWidget(small, Rect2<int>(0, 0, 10, 10))
+      .AddWidget(large, Rect2<int>(10, 0, 190, 100));
+  small->set_cached_as_layer(true);
+  large->set_cached_as_layer(true);
+
+  // Only the layer of the small widget fits
+  auto& cache = screen->layer_cache();
+  cache.set_budget(100 * 100 * 4);
+  for (int i = 0; i < 3; i++) {
+    screen->Clear();
+    layout.Render(Rect2<int>(0, 0, 200, 100));
+    screen->Flush();
+  }
+  Check(screen->layers == 1, "layers over budget are not created");
+  Check(small->draws == 1 && large->draws == 3,
+        "widgets over budget are drawn directly");
+  Check(cache.size() == 1 && cache.memory_usage() == 10 * 10 * 4,
+        "only layers within budget are accounted");
+  Check(PixelAt(*screen, 100, 50) == PackedColor(Color::kRed).value,
+        "widgets over budget are drawn");
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestFindAtRespectsZOrder();
+  TestMouseMotionDoesNotAllocate();
+  TestDrawStatsAreAccountedPerWidget();
+  TestDrawCullsHiddenChildren();
+  TestScrollLayoutOnlyCreatesRowsInSight();
+  TestRetainedWidgetsReplayTheirOutput();
+  TestLayersAreCompositedUntilInvalidated();
+  TestLayersOverBudgetAreNotCreated();
+  TestParentIsClearedOnRemoval();
+  TestDrawCostOverlayShadesChildrenInSight();
+  TestDraggedWidgetOutlivesRemoval();
+  TestWidgetAddedTwiceIsPlacedOnce();
+  TestEmptySoftwareScreenDrawsNothing();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
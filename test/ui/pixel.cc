@@ -0,0 +1,123 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <grog/ui/pixel.h>
+
+using namespace grog::ui;
+
+namespace {
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+const PixelInstructionSet kInstructionSets[] = {
+  kSSE2InstructionSet,
+  kAVX2InstructionSet,
+};
+
+std::vector<UInt32> RandomPixels(std::size_t len) {
+  std::vector<UInt32> pixels(len);
+  for (auto& pixel : pixels)
+    pixel = PackPixel(std::rand() % 256, std::rand() % 256,
+                      std::rand() % 256, std::rand() % 256);
+  return pixels;
+}
+
+/*
+ * Every vector kernel must produce exactly the same pixels as the scalar
+ * one, including on spans that are not a multiple of the vector width.
+ */
+void TestKernelsMatchScalar() {
+  std::srand(1);
+  auto& scalar = PixelKernels::ForInstructionSet(
+      kScalarInstructionSet).value();
+  for (auto instruction_set : kInstructionSets) {
+    auto kernels = PixelKernels::ForInstructionSet(instruction_set);
+    if (!kernels)
+      continue;
+    for (std::size_t len = 0; len < 70; len++) {
+      auto pixel = RandomPixels(1)[0];
+      auto expected = RandomPixels(len + 2);
+      auto actual = expected;
+
+      // Offset by one pixel to exercise unaligned spans
+      scalar.blend_span(&expected[1], len, pixel);
+      kernels.value().blend_span(&actual[1], len, pixel);
+      if (actual != expected)
+        Fail(boost::format("blend with instruction set %d differs on %d "
+                           "pixels") % instruction_set % len);
+
+      scalar.fill_span(&expected[1], len, pixel);
+      kernels.value().fill_span(&actual[1], len, pixel);
+      if (actual != expected)
+        Fail(boost::format("fill with instruction set %d differs on %d "
+                           "pixels") % instruction_set % len);
+    }
+  }
+}
+
+void TestBlendSourceOver() {
+  std::vector<UInt32> pixels(5, PackPixel(0, 0, 0, 255));
+  BlendSpan(&pixels[0], pixels.size(), PackPixel(255, 255, 255, 128));
+  if (pixels[4] != PackPixel(128, 128, 128, 255))
+    Fail(boost::format("half white over black is not mid grey"));
+
+  BlendSpan(&pixels[0], pixels.size(), PackPixel(10, 20, 30, 255));
+  if (pixels[4] != PackPixel(10, 20, 30, 255))
+    Fail(boost::format("opaque blend doesn't replace the pixels"));
+
+  BlendSpan(&pixels[0], pixels.size(), PackPixel(200, 200, 200, 0));
+  if (pixels[4] != PackPixel(10, 20, 30, 255))
+    Fail(boost::format("transparent blend modifies the pixels"));
+}
+
+// Conversion from Color must be usable at compile time
+static_assert(PackedColor(Color{ 1.0f, 0.5f, 0.0f, 1.0f }).g() == 128,
+              "float channels are rounded to nearest");
+static_assert(sizeof(PackedColor) == 4, "packed colors take 32 bits");
+
+void TestPackedColorLayout() {
+  PackedColor color(Color{ 0.0f, 0.2f, 0.6f, 1.0f });
+  auto bytes = reinterpret_cast<const UInt8*>(&color);
+  if (bytes[0] != 0 || bytes[1] != 51 || bytes[2] != 153 || bytes[3] != 255)
+    Fail(boost::format("packed color bytes %d %d %d %d are not RGBA") %
+         int(bytes[0]) % int(bytes[1]) % int(bytes[2]) % int(bytes[3]));
+  if (color.r() != 0 || color.g() != 51 || color.b() != 153 ||
+      !color.opaque())
+    Fail(boost::format("packed color channels don't match the bytes"));
+  if (PackedColor::kLightBlue != PackedColor(Color::kLightBlue))
+    Fail(boost::format("packed constants don't match the Color ones"));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestKernelsMatchScalar();
+  TestBlendSourceOver();
+  TestPackedColorLayout();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
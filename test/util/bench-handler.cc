@@ -0,0 +1,82 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <list>
+
+#include <boost/format.hpp>
+#include <grog/util/handler.h>
+
+using grog::util::HandlerTable;
+using grog::util::HandlerToken;
+
+namespace {
+
+typedef std::function<void(int)> Handler;
+
+const int kHandlerCounts[] = { 1, 100, 10000 };
+const long kInvocationCount = 20000000;
+
+volatile long sink = 0;
+
+template <typename Dispatch>
+double MeasureDispatch(int handler_count, Dispatch dispatch) {
+  long event_count = kInvocationCount / handler_count;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < event_count; i++)
+    dispatch(int(i));
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+  return double(elapsed.count()) / event_count;
+}
+
+/*
+ * Register handlers interleaved with short-lived ones that are removed
+ * right away, as views that come and go would do.
+ */
+void RunBenchmark(int handler_count) {
+  std::list<Handler> list;
+  HandlerTable<Handler> table;
+  for (int i = 0; i < handler_count; i++) {
+    auto handler = [](int ev) { sink += ev; };
+    list.push_back(handler);
+    table.Remove(table.Add(handler));
+    table.Add(handler);
+  }
+
+  auto list_ns = MeasureDispatch(handler_count, [&list](int ev) {
+    for (auto& handler : list)
+      handler(ev);
+  });
+  auto table_ns = MeasureDispatch(handler_count, [&table](int ev) {
+    table.Dispatch(ev);
+  });
+  std::cout << boost::format(
+      "%6d handlers: list %10.1f ns/event, table %10.1f ns/event") %
+      handler_count % list_ns % table_ns << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  for (auto handler_count : kHandlerCounts)
+    RunBenchmark(handler_count);
+  return 0;
+}
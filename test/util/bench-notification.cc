@@ -0,0 +1,142 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <list>
+
+#include <boost/format.hpp>
+#include <grog/util/lang.h>
+
+using grog::util::NotificationChannel;
+using grog::util::Ptr;
+
+namespace {
+
+const int kSubscriberCounts[] = { 10, 100, 1000 };
+const int kMessageTypeCount = 10;
+const long kNotificationCount = 200000;
+
+struct Widget : NotificationChannel::Sender {};
+
+template <int N>
+struct Event : NotificationChannel::Message {};
+
+volatile long sink = 0;
+
+/*
+ * The former channel: every notification is broadcast to all subscribers,
+ * and each of them checks the types with dynamic_cast.
+ */
+class BroadcastChannel {
+public:
+
+  template <typename S, typename T>
+  void Notify(const S& s, const T& t) {
+    for (auto& subscriber : subscribers_)
+      subscriber->Receive(s, t);
+  }
+
+  template <typename S, typename T>
+  void Listen(const std::function<void(const S&, const T&)>& callback) {
+    subscribers_.push_back(new TypedSubscriber<S, T>(callback));
+  }
+
+private:
+
+  class Subscriber {
+  public:
+    inline virtual ~Subscriber() {}
+    virtual void Receive(const NotificationChannel::Sender& sender,
+                         const NotificationChannel::Message& msg) = 0;
+  };
+
+  template <typename S, typename T>
+  class TypedSubscriber : public Subscriber {
+  public:
+
+    TypedSubscriber(const std::function<void(const S&, const T&)>& callback)
+      : callback_(callback) {}
+
+    virtual void Receive(const NotificationChannel::Sender& sender,
+                         const NotificationChannel::Message& msg) {
+      auto typed_sender = dynamic_cast<const S*>(&sender);
+      auto typed_msg = dynamic_cast<const T*>(&msg);
+      if (typed_sender && typed_msg)
+        callback_(*typed_sender, *typed_msg);
+    }
+
+  private:
+    std::function<void(const S&, const T&)> callback_;
+  };
+
+  std::list<Ptr<Subscriber> > subscribers_;
+};
+
+/*
+ * Subscribe to the message types round robin, so each type has
+ * subscriber_count / kMessageTypeCount interested subscribers.
+ */
+template <typename Channel, int N = kMessageTypeCount - 1>
+struct Subscribe {
+  static void To(Channel& channel, int subscriber_count) {
+    for (int i = N; i < subscriber_count; i += kMessageTypeCount) {
+      channel.template Listen<Widget, Event<N> >(
+          [](const Widget&, const Event<N>&) { sink++; });
+    }
+    Subscribe<Channel, N - 1>::To(channel, subscriber_count);
+  }
+};
+
+template <typename Channel>
+struct Subscribe<Channel, -1> {
+  static void To(Channel& channel, int subscriber_count) {}
+};
+
+template <typename Channel>
+double MeasureNotifications(int subscriber_count) {
+  Channel channel;
+  Subscribe<Channel>::To(channel, subscriber_count);
+  Widget widget;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < kNotificationCount; i += 2) {
+    channel.Notify(widget, Event<0>());
+    channel.Notify(widget, Event<1>());
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+  return double(elapsed.count()) / kNotificationCount;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  for (auto subscriber_count : kSubscriberCounts) {
+    auto broadcast_ns = MeasureNotifications<BroadcastChannel>(
+        subscriber_count);
+    auto indexed_ns = MeasureNotifications<NotificationChannel>(
+        subscriber_count);
+    std::cout << boost::format(
+        "%5d subscribers, %d message types: "
+        "broadcast %9.1f ns/notify, indexed %9.1f ns/notify") %
+        subscriber_count % kMessageTypeCount % broadcast_ns % indexed_ns <<
+        std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <grog/util/concurrent.h>
+
+using grog::util::MPSCQueue;
+
+namespace {
+
+const int kProducerCount = 8;
+const int kItemsPerProducer = 200000;
+
+struct Item {
+  int producer;
+  int seq;
+};
+
+/*
+ * Several producers hammer the queue while a single consumer drains it. The
+ * consumer checks that every item arrives exactly once, and that items of
+ * each producer arrive in the order they were pushed.
+ */
+bool TestConcurrentPushAndPop() {
+  MPSCQueue<Item> queue;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducerCount; p++) {
+    producers.push_back(std::thread([&queue, p]() {
+      for (int i = 0; i < kItemsPerProducer; i++) {
+        Item item = { p, i };
+        queue.Push(item);
+      }
+    }));
+  }
+
+  std::vector<int> next_seq(kProducerCount, 0);
+  long remaining = long(kProducerCount) * kItemsPerProducer;
+  bool ok = true;
+  Item item;
+  while (remaining > 0) {
+    if (!queue.Pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (item.seq != next_seq[item.producer]) {
+      std::cerr << boost::format(
+          "FAILED: producer %d item %d received, %d expected") %
+          item.producer % item.seq % next_seq[item.producer] << std::endl;
+      ok = false;
+    }
+    next_seq[item.producer] = item.seq + 1;
+    remaining--;
+  }
+
+  for (auto& producer : producers)
+    producer.join();
+
+  if (queue.Pop(item)) {
+    std::cerr << "FAILED: queue not empty after consuming all items"
+              << std::endl;
+    ok = false;
+  }
+  return ok;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  return TestConcurrentPushAndPop() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
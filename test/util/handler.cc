@@ -0,0 +1,98 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <grog/util/handler.h>
+
+using grog::util::HandlerTable;
+using grog::util::HandlerToken;
+
+namespace {
+
+typedef std::function<void(int)> Handler;
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+void TestRemovedHandlersAreNotInvoked() {
+  HandlerTable<Handler> table;
+  std::vector<int> calls(3);
+  std::vector<HandlerToken> tokens;
+  for (int i = 0; i < 3; i++)
+    tokens.push_back(table.Add([&calls, i](int) { calls[i]++; }));
+  if (!table.Remove(tokens[1]))
+    Fail(boost::format("cannot remove a registered handler"));
+  if (table.Remove(tokens[1]))
+    Fail(boost::format("handler removed twice"));
+  table.Dispatch(0);
+  if (calls != std::vector<int>({ 1, 0, 1 }))
+    Fail(boost::format("removed handler invoked"));
+
+  // The slot is reused, but the stale token must not match the new handler
+  auto token = table.Add([&calls](int) { calls[1] += 10; });
+  if (token.slot != tokens[1].slot)
+    Fail(boost::format("slot of removed handler not reused"));
+  if (table.Remove(tokens[1]))
+    Fail(boost::format("stale token removed a new handler"));
+  table.Dispatch(0);
+  if (calls != std::vector<int>({ 2, 10, 2 }) || table.size() != 3)
+    Fail(boost::format("new handler not invoked"));
+  if (table.Remove(HandlerToken()))
+    Fail(boost::format("invalid token removed a handler"));
+}
+
+void TestChangesDuringDispatch() {
+  HandlerTable<Handler> table;
+  std::vector<int> calls(4);
+  HandlerToken tokens[4];
+  tokens[0] = table.Add([&](int) {
+    calls[0]++;
+    // Removes itself and the next handler, and adds a couple of new ones
+    table.Remove(tokens[0]);
+    table.Remove(tokens[1]);
+    tokens[2] = table.Add([&](int) { calls[2]++; });
+    tokens[3] = table.Add([&](int) { calls[3]++; });
+  });
+  tokens[1] = table.Add([&](int) { calls[1]++; });
+
+  table.Dispatch(0);
+  if (calls != std::vector<int>({ 1, 0, 0, 0 }))
+    Fail(boost::format("unexpected handlers invoked during dispatch"));
+  table.Dispatch(0);
+  if (calls != std::vector<int>({ 1, 0, 1, 1 }) || table.size() != 2)
+    Fail(boost::format("handlers added during dispatch not invoked"));
+  if (!table.Remove(tokens[2]) || !table.Remove(tokens[3]) || !table.empty())
+    Fail(boost::format("cannot remove handlers added during dispatch"));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestRemovedHandlersAreNotInvoked();
+  TestChangesDuringDispatch();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <grog/util/lang.h>
+
+using grog::util::NotificationChannel;
+
+namespace {
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+struct Button : NotificationChannel::Sender {};
+struct Slider : NotificationChannel::Sender {};
+
+struct Clicked : NotificationChannel::Message {};
+struct DoubleClicked : Clicked {};
+struct Moved : NotificationChannel::Message {
+  int value;
+  inline Moved(int value) : value(value) {}
+};
+
+void TestOnlyInterestedSubscribersAreNotified() {
+  NotificationChannel channel;
+  int any = 0, clicks = 0, button_clicks = 0, slider_clicks = 0, moves = 0;
+  channel.Listen([&]() { any++; });
+  channel.Listen<Clicked>([&](const Clicked&) { clicks++; });
+  channel.Listen<Button, Clicked>(
+      [&](const Button&, const Clicked&) { button_clicks++; });
+  channel.Listen<Slider, Clicked>(
+      [&](const Slider&, const Clicked&) { slider_clicks++; });
+  channel.Listen<Moved>([&](const Moved& msg) { moves += msg.value; });
+
+  Button button;
+  channel.Notify(button, Clicked());
+  channel.Notify(button, DoubleClicked());
+  channel.Notify(button, Moved(5));
+  channel.Notify(button, Moved(7));
+  if (any != 4 || clicks != 2 || button_clicks != 2 || slider_clicks != 0 ||
+      moves != 12)
+    Fail(boost::format("unexpected notifications: %d %d %d %d %d") %
+         any % clicks % button_clicks % slider_clicks % moves);
+
+  // Notified through references to the base types, dispatch is dynamic
+  const NotificationChannel::Sender& sender = button;
+  const NotificationChannel::Message& msg = DoubleClicked();
+  channel.Notify(sender, msg);
+  if (button_clicks != 3)
+    Fail(boost::format("dispatch depends on static types"));
+}
+
+void TestUnsubscribe() {
+  NotificationChannel channel;
+  std::vector<int> calls(3);
+  std::vector<NotificationChannel::SubscriptionId> ids(3);
+  ids[0] = channel.Listen<Clicked>([&](const Clicked&) {
+    calls[0]++;
+    // Unsubscribes itself and the next subscriber while being notified
+    channel.Unsubscribe(ids[0]);
+    channel.Unsubscribe(ids[1]);
+  });
+  ids[1] = channel.Listen<Clicked>([&](const Clicked&) { calls[1]++; });
+  ids[2] = channel.Listen<Clicked>([&](const Clicked&) { calls[2]++; });
+
+  Button button;
+  channel.Notify(button, Clicked());
+  channel.Notify(button, Clicked());
+  if (calls != std::vector<int>({ 1, 0, 2 }))
+    Fail(boost::format("unsubscribed subscribers notified"));
+  if (channel.Unsubscribe(ids[0]))
+    Fail(boost::format("subscription cancelled twice"));
+}
+
+void TestPostedNotificationsAreCoalesced() {
+  NotificationChannel channel;
+  int schedules = 0;
+  channel.set_flush_scheduler([&]() { schedules++; });
+  std::vector<int> moves;
+  int clicks = 0;
+  channel.Listen<Moved>([&](const Moved& msg) { moves.push_back(msg.value); });
+  channel.Listen<Clicked>([&](const Clicked&) { clicks++; });
+
+  Slider slider1, slider2;
+  for (int i = 0; i < 100; i++) {
+    channel.Post(slider1, Moved(i));
+    channel.Post(slider2, Moved(-i));
+    channel.Post(slider1, Clicked());
+  }
+  if (!moves.empty() || clicks || channel.pending() != 3 || schedules != 1)
+    Fail(boost::format("posted notifications not coalesced"));
+
+  channel.Flush();
+  if (moves != std::vector<int>({ 99, -99 }) || clicks != 1)
+    Fail(boost::format("coalesced notifications not delivered once"));
+
+  channel.Post(slider1, Moved(1));
+  if (schedules != 2)
+    Fail(boost::format("flush not scheduled after previous flush"));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestOnlyInterestedSubscribersAreNotified();
+  TestUnsubscribe();
+  TestPostedNotificationsAreCoalesced();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/format.hpp>
+#include <grog/util/profile.h>
+
+using grog::util::Profiler;
+using grog::util::ProfileScope;
+
+namespace {
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+std::size_t CountOf(const std::string& text, const std::string& pattern) {
+  std::size_t count = 0;
+  for (auto pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1))
+    count++;
+  return count;
+}
+
+void TestScopesAreExportedPerThread() {
+  Profiler profiler(16);
+  {
+    ProfileScope outer("outer", profiler);
+    ProfileScope inner("inner", profiler);
+  }
+  std::thread worker([&profiler]() {
+    for (int i = 0; i < 100; i++)
+      ProfileScope scope("worker", profiler);
+  });
+  worker.join();
+
+  std::ostringstream out;
+  profiler.ExportChromeTrace(out);
+  auto trace = out.str();
+  if (trace.find("{\"traceEvents\":[") != 0)
+    Fail(boost::format("not a Chrome trace: %s") % trace.substr(0, 40));
+  if (CountOf(trace, "\"name\":\"outer\"") != 1 ||
+      CountOf(trace, "\"name\":\"inner\"") != 1)
+    Fail(boost::format("scopes of the main thread not exported"));
+
+  // The worker buffer wrapped around, only the last events are kept
+  if (CountOf(trace, "\"name\":\"worker\"") != 16)
+    Fail(boost::format("%d worker events exported out of 16") %
+         CountOf(trace, "\"name\":\"worker\""));
+  if (!CountOf(trace, "\"tid\":1,") || !CountOf(trace, "\"tid\":2,"))
+    Fail(boost::format("threads not told apart"));
+
+  profiler.Clear();
+  std::ostringstream cleared;
+  profiler.ExportChromeTrace(cleared);
+  if (CountOf(cleared.str(), "\"ph\":\"X\""))
+    Fail(boost::format("events exported after clear"));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestScopesAreExportedPerThread();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
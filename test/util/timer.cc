@@ -0,0 +1,118 @@
+/* This file is part of Grog.
+ *
+ * Copyright (c) 2013 Alvaro Polo
+ *
+ * Grog is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Grog is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <grog/util/timer.h>
+
+using grog::util::TimerWheel;
+
+namespace {
+
+typedef TimerWheel<int>::Ticks Ticks;
+
+int failures = 0;
+
+void Fail(const boost::format& msg) {
+  std::cerr << "FAILED: " << msg << std::endl;
+  failures++;
+}
+
+/*
+ * Schedule timers with deadlines spread over all the levels of the wheel,
+ * cancel some of them, and advance time in random steps. Every remaining
+ * timer must expire exactly on the step that reaches its deadline.
+ */
+void TestTimersExpireOnDeadline() {
+  std::srand(1);
+  Ticks now = 1000;
+  TimerWheel<int> wheel(now);
+  std::map<int, Ticks> deadlines;
+  std::vector<TimerWheel<int>::TimerId> ids;
+  for (int i = 0; i < 20000; i++) {
+    // Exponentially distributed delays, up to beyond the wheel range
+    Ticks delay = Ticks(std::rand()) % (Ticks(1) << (std::rand() % 28));
+    deadlines[i] = now + delay;
+    ids.push_back(wheel.Schedule(now + delay, i));
+  }
+  for (int i = 0; i < 20000; i += 7) {
+    wheel.Cancel(ids[i]);
+    deadlines.erase(i);
+  }
+
+  // The tick the wheel was created on is yet to be processed
+  Ticks advanced = now - 1;
+  std::vector<int> expired;
+  while (!deadlines.empty()) {
+    auto next = wheel.NextDeadline();
+    Ticks earliest = deadlines.begin()->second;
+    for (auto& d : deadlines)
+      earliest = std::min(earliest, d.second);
+    if (!next || next.value() > earliest) {
+      Fail(boost::format("next deadline later than %d") % earliest);
+      return;
+    }
+
+    now += 1 + Ticks(std::rand()) % (Ticks(1) << (std::rand() % 20));
+    expired.clear();
+    wheel.Advance(now, expired);
+    for (int timer : expired) {
+      auto deadline = deadlines.find(timer);
+      if (deadline == deadlines.end()) {
+        Fail(boost::format("timer %d expired twice or after cancel") % timer);
+        continue;
+      }
+      if (deadline->second <= advanced || deadline->second > now)
+        Fail(boost::format("timer %d due on %d expired on (%d, %d]") %
+             timer % deadline->second % advanced % now);
+      deadlines.erase(deadline);
+    }
+    advanced = now;
+    for (auto& d : deadlines) {
+      if (d.second <= now) {
+        Fail(boost::format("timer %d due on %d not expired on %d") %
+             d.first % d.second % now);
+        return;
+      }
+    }
+  }
+
+  if (!wheel.empty() || wheel.NextDeadline())
+    Fail(boost::format("wheel not empty after all timers expired"));
+}
+
+void TestPastDeadlineExpiresOnNextAdvance() {
+  TimerWheel<int> wheel(100);
+  wheel.Schedule(50, 1);
+  std::vector<int> expired;
+  wheel.Advance(100, expired);
+  if (expired.size() != 1)
+    Fail(boost::format("past timer not expired on next advance"));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  TestTimersExpireOnDeadline();
+  TestPastDeadlineExpiresOnNextAdvance();
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}